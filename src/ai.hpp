@@ -2,21 +2,86 @@
 
 #include <cassert>
 #include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <array>
+#include <limits>
+#include <memory>
+#include <ostream>
 #include <tuple>
 #include <ranges>
-#include <unordered_map>
+#include <span>
+#include <vector>
 
-#include "log.hpp"
+#include "book.hpp"
+#include "config.hpp"
 #include "eval.hpp"
+#include "mcts.hpp"
 #include "board.hpp"
+#include "nnue.hpp"
+#include "perf.hpp"
+#include "resumable.hpp"
 #include "zobrist.hpp"
+#include "shared_table.hpp"
+#include "snapshot.hpp"
+#include "thread_pool.hpp"
+#include "time_manager.hpp"
+#include "tree_log.hpp"
 
 namespace nara
 {
 
 class gomoku_ai
 {
+  public:
+
+    struct search_res_t
+    {
+        int depth;
+        int score;
+        point_t p;
+
+        search_res_t(int _depth, int _score, point_t _p): depth(_depth), score(_score), p(_p) {}
+    };
+
+    // A root move scored with a full window, and the line the search expects.
+    struct root_move_t
+    {
+        point_t p;
+        int score;
+        std::vector<point_t> pv;
+    };
+
+    struct perft_res_t
+    {
+        long leaves = 0;
+        long nodes = 0;
+
+        // nodes where an incrementally updated state differed from get_state
+        long mismatches = 0;
+    };
+
+    // Marks points that are not candidates in a heatmap.
+    static constexpr int no_score = std::numeric_limits<int>::min();
+
+    using heatmap_t = std::array<std::array<int, 15>, 15>;
+
+    struct search_stats_t
+    {
+        long nodes = 0;
+        long null_tries = 0;
+        long null_cutoffs = 0;
+        long lmr_reductions = 0;
+        long lmr_researches = 0;
+        long futility_prunes = 0;
+        long qs_nodes = 0;
+        long qs_stand_pats = 0;
+        long qs_limit_hits = 0;
+        long extensions = 0;
+        long singular_tests = 0;
+        long singular_extensions = 0;
+    };
+
   private:
 
     gomoku_chess mine;
@@ -29,18 +94,104 @@ class gomoku_ai
 
     int cache_hit;
 
-    struct search_res_t
+    int shared_hit;
+
+    search_config config;
+
+    search_stats_t stats;
+
+    // hardware counters per region of the last search, see perf.hpp
+    perf_profile perf;
+
+    int root_depth = 0;
+
+    bool in_null = false;
+
+    // singular tests the current node is nested in; their searches can run
+    // further tests
+    int singular_nesting = 0;
+
+    tree_recorder *recorder = nullptr;
+
+    // plies the current line has been extended by
+    int path_extensions = 0;
+
+    // nodes of the quiescence search below the current horizon node
+    long qs_root_nodes = 0;
+
+    long node_limit = 0;
+
+    const search_limits *limits = nullptr;
+
+    search_progress progress;
+
+    std::chrono::steady_clock::time_point search_start;
+
+    time_manager timer;
+
+    bool stopped = false;
+
+    // node count at which a sliced search pauses, see search_steps
+    long yield_at = 0;
+
+    bool yielded = false;
+
+    // stops a helper of score_root_moves
+    const std::atomic<bool> *analysis_cancel = nullptr;
+
+    // engines that score root moves on the workers of a thread_pool
+    std::vector<std::unique_ptr<gomoku_ai>> helpers;
+
+    // the Monte Carlo backend, see search_config::backend
+    mcts_tree tree;
+    std::unique_ptr<thread_pool> mcts_pool;
+
+    const opening_book *book = nullptr;
+
+    // search statistics and book moves are written here when set
+    std::ostream *log = nullptr;
+
+    shared_result_table *shared_table = nullptr;
+
+    const nnue_network *network = nullptr;
+
+    nnue_accumulator accumulator;
+
+    enum bound_t : uint8_t
+    {
+        EXACT,
+        LOWER,
+        UPPER,
+    };
+
+    // Entries are keyed by the canonical key of the node's position, so the
+    // best move is kept in the canonical orientation.
+    struct tt_entry_t
     {
         int depth;
         int score;
+        bound_t bound;
         point_t p;
+    };
 
-        search_res_t(int _depth, int _score, point_t _p): depth(_depth), score(_score), p(_p) {}
+    symmetric_key zob;
+
+    // states, keys and accumulator match the board, see sync_position
+    bool synced = false;
+
+    // A fixed number of slots picked by the low bits of the key, so the
+    // table stays bounded however long the engine lives; a store replaces
+    // whatever its slot held. Key 0 marks an empty slot. Allocated on the
+    // first store.
+    struct tt_slot_t
+    {
+        uint64_t key;
+        tt_entry_t entry;
     };
 
-    zobrist_t zob;
+    static constexpr size_t tt_slots = size_t(1) << 17;
 
-    std::unordered_map<zobrist_t, search_res_t, zobrist_hash, zobrist_eq> zob_table;
+    std::vector<tt_slot_t> zob_table;
 
     static constexpr auto initial_chooses()
     {
@@ -54,22 +205,37 @@ class gomoku_ai
 
     void setchess(point_t pos, gomoku_chess chess)
     {
+        NARA_PERF_SCOPE(perf, REGION_MAKE_UNMAKE);
+
+        zob.toggle(pos, (chess == EMPTY) ? board.getchess(pos) : chess);
+
+        if (network)
+        {
+            if (chess == EMPTY)
+                network->remove(accumulator, pos, board.getchess(pos));
+            else
+                network->add(accumulator, pos, chess);
+        }
+
         board.setchess(pos, chess);
-        zob[pos.x][pos.y] = zobrist_val(pos, chess);
 
+        // only the cells of each line inside the board, without a bounds
+        // check per step
         for (int dir = 0; dir < 4; dir++)
         {
-            for (int fac = -4; fac <= 4; fac++)
-            {
-                auto p = pos + directions[dir] * fac;
-                if (fac != 0 and not board.outbox(p))
-                    states[p.x][p.y].update_chess(chess, dir, -fac);
-            }
+            auto [back, forward] = line_reach[pos.x][pos.y][dir];
+            point_t d = directions[dir];
+            for (int fac = -back; fac < 0; fac++)
+                states[pos.x + d.x * fac][pos.y + d.y * fac].update_chess(chess, dir, -fac);
+            for (int fac = 1; fac <= forward; fac++)
+                states[pos.x + d.x * fac][pos.y + d.y * fac].update_chess(chess, dir, -fac);
         }
     }
 
     std::vector<point_t> gen_chooses(gomoku_board const& board, gomoku_chess next)
     {
+        NARA_PERF_SCOPE(perf, REGION_MOVE_GEN);
+
         static constexpr auto all_points = initial_chooses();
 
         std::vector<point_t> me_five, op_five;
@@ -167,19 +333,15 @@ class gomoku_ai
         if (not me_b4f3.empty()) return me_b4f3;
 
         if (not op_flex4.empty())
-        {
-            auto ret = op_flex4;
-            ret.insert(ret.end(), me_block4.begin(), me_block4.end());
-            return ret;
-        }
+            return gen_defenses(op_flex4, oppof(next), me_block4, [](auto const& have) { return have[FLEX4] > 0; });
 
         if (not op_b4b4.empty())
-        {
-            auto ret = op_b4b4;
-            ret.insert(ret.end(), me_block4.begin(), me_block4.end());
-            return ret;
-        }
+            return gen_defenses(op_b4b4, oppof(next), me_block4, [](auto const& have) { return have[BLOCK4] > 1; });
 
+        // Against a four-three or a double three the exact defences also
+        // take the far ends of the threes, which widens the tree more than
+        // it gains at the depths we search, so only the threat points are
+        // tried there.
         if (not op_b4f3.empty())
         {
             auto ret = op_b4f3;
@@ -218,6 +380,70 @@ class gomoku_ai
         return ret;
     }
 
+    // Answers to the opponent's threats: the moves after which none of the
+    // `threats` points still makes a threat by `is_threat`, plus our fours.
+    // A point stops being a threat when it is taken or when a stone on one
+    // of its lines lowers that line's category, and pattern_info::defense
+    // lists the cells that can do the latter. If no single move answers all
+    // threats every threat point is kept, as the counter-fours are the only
+    // hope.
+    template <typename F>
+    std::vector<point_t> gen_defenses(std::vector<point_t> const& threats, gomoku_chess op,
+                                      std::vector<point_t> const& counters, F&& is_threat)
+    {
+        int hits[15][15] = {};
+        std::vector<point_t> candidates;
+
+        for (auto p : threats)
+        {
+            auto & state = states[p.x][p.y];
+
+            int cats[4];
+            for (int dir = 0; dir < 4; dir++)
+                cats[dir] = get_category(state.get_pattern(op, dir));
+
+            if (hits[p.x][p.y]++ == 0)
+                candidates.push_back(p);
+
+            for (int dir = 0; dir < 4; dir++)
+            {
+                auto pattern = state.get_pattern(op, dir);
+                uint8_t mask = pattern_of(pattern).defense;
+                for (int bit = 0; bit < 8; bit++)
+                {
+                    if (not (mask & (1 << bit)))
+                        continue;
+
+                    chess_state::all_category have = {0};
+                    for (int d = 0; d < 4; d++)
+                        have[(d == dir) ? get_category(pattern[0], pattern[1] | (1 << bit)) : cats[d]]++;
+                    if (is_threat(have))
+                        continue;
+
+                    auto c = p + directions[dir] * pattern_offset(bit);
+                    if (hits[c.x][c.y]++ == 0)
+                        candidates.push_back(c);
+                }
+            }
+        }
+
+        std::vector<point_t> ret;
+        for (auto c : candidates)
+        {
+            if (hits[c.x][c.y] == (int)threats.size())
+                ret.push_back(c);
+        }
+        if (ret.empty())
+            ret = threats;
+
+        for (auto c : counters)
+        {
+            if (std::ranges::find(ret, c) == ret.end())
+                ret.push_back(c);
+        }
+        return ret;
+    }
+
     int evaluate(gomoku_chess chess)
     {
         int val = 0;
@@ -228,168 +454,1304 @@ class gomoku_ai
         return val;
     }
 
-  public:
-    gomoku_ai(gomoku_chess chess): mine(chess) { init_zobrist(); }
-
-    search_res_t
-    alphabeta(point_t last_move, gomoku_chess next, int alpha, int beta, bool ismax, int depth)
+    int static_eval()
     {
-        if (depth < 50) depth_tracker[depth]++;
+        NARA_PERF_SCOPE(perf, REGION_EVALUATE);
 
-        // cache hit
-        if (zob_table.find(zob) != zob_table.end())
+        if (network)
+            return network->evaluate(accumulator, mine);
+        return evaluate(mine) - evaluate(oppof(mine));
+    }
+
+    // Whether `chess` can reach category `cat` or better with one move.
+    bool can_make(gomoku_chess chess, int cat)
+    {
+        for (int i = 0; i < 15; i++)
         {
-            auto res = zob_table.at(zob);
-            if (res.depth >= depth)
+            for (int j = 0; j < 15; j++)
             {
-                cache_hit++;
-                return res;
+                if (board.getchess(i, j) != EMPTY or not states[i][j].has_neighbor())
+                    continue;
+                auto have = states[i][j].cats_for(chess);
+                for (int c = cat; c <= FIVE; c++)
+                    if (have[c])
+                        return true;
             }
         }
+        return false;
+    }
 
-        if (depth == 0)
-            return search_res_t(depth, evaluate(mine) - evaluate(oppof(mine)), last_move);
-
-        auto chooses = gen_chooses(board, next);
-
-        // if (chooses.size() == 1)
-        // {
-        //     setchess(chooses[0], next);
-        //     auto res = alphabeta(chooses[0], oppof(next), alpha, beta, false, 0);
-        //     setchess(chooses[0], EMPTY);
-        //     return res;
-        // }
+    // A move is quiet when it neither makes nor blocks a three or a four.
+    bool is_quiet(point_t p)
+    {
+        auto blk = states[p.x][p.y].cats_for(BLACK);
+        auto wht = states[p.x][p.y].cats_for(WHITE);
+        for (int c = FLEX3; c <= FIVE; c++)
+            if (blk[c] or wht[c])
+                return false;
+        return true;
+    }
 
-        point_t bestpos;
-        zobrist_t bestzob;
+    // Plies `choose` is searched deeper by, see search_config::extensions.
+    // `forced` is set when the side to move faces a four.
+    int extension_of(point_t choose, gomoku_chess next, bool forced, point_t singular_move)
+    {
+        if (path_extensions >= config.max_extensions)
+            return 0;
+        if (choose == singular_move)
+            return 1;
+        if (not config.extensions)
+            return 0;
+        if (forced)
+            return 1;
+        auto have = states[choose.x][choose.y].cats_for(next);
+        return (have[FLEX4] or have[BLOCK4] or have[FLEX3] > 1) ? 1 : 0;
+    }
 
-        if (ismax)
+    // Whether every move but `tt_move` falls `singular_margin` short of the
+    // TT score in a search of half the depth.
+    bool is_singular(point_t tt_move, std::vector<point_t> const& chooses, gomoku_chess next,
+                     bool ismax, int depth, int tt_score)
+    {
+        stats.singular_tests++;
+        singular_nesting++;
+        int bound = ismax ? tt_score - config.singular_margin : tt_score + config.singular_margin;
+        for (auto choose : chooses)
         {
-            int score = score_lose;
-            for (auto & choose : chooses)
-            {
-                setchess(choose, next);
-
-                // win
-                if (states[choose.x][choose.y].has_category(next, FIVE))
-                {
-                    auto res = search_res_t(depth, score_win, choose);
-                    zob_table.insert_or_assign(zob, res);
-                    setchess(choose, EMPTY);
-                    return res;
-                }
-
-                auto res = alphabeta(choose, oppof(next), alpha, beta, false, depth - 1);
-
-                if(res.score > score)
-                {
-                    bestpos = choose;
-                    bestzob = zob;
-                }
-
-                setchess(choose, EMPTY);
+            if (choose == tt_move)
+                continue;
 
-                score = std::max(score, res.score);
-                alpha = std::max(alpha, score);
+            setchess(choose, next);
+            bool wins = states[choose.x][choose.y].has_category(next, FIVE);
+            auto res = wins ? search_res_t(0, ismax ? score_win : score_lose, choose)
+                     : ismax ? alphabeta(choose, oppof(next), bound - 1, bound, false, depth / 2 - 1)
+                             : alphabeta(choose, oppof(next), bound, bound + 1, true, depth / 2 - 1);
+            setchess(choose, EMPTY);
 
-                if(beta <= alpha)
-                    break;
+            if (stopped or (ismax ? res.score >= bound : res.score <= bound))
+            {
+                singular_nesting--;
+                return false;
             }
-            auto res = search_res_t(depth, score, bestpos);
-            zob_table.insert_or_assign(bestzob, res);
-            return res;
         }
+        singular_nesting--;
+        return true;
+    }
 
-        // ismin
-        int score = score_win;
-        for (auto & choose : chooses)
+    // Searches `choose` (already played) for the node's side, reduced with a
+    // null window first when `reduce` is set.
+    search_res_t search_move(point_t choose, gomoku_chess next, int alpha, int beta, bool ismax, int depth, bool reduce)
+    {
+        if (reduce)
         {
-            setchess(choose, next);
+            stats.lmr_reductions++;
+            int reduced = std::max(depth - 1 - config.lmr_reduction, 0);
+            auto res = ismax ? alphabeta(choose, oppof(next), alpha, alpha + 1, false, reduced)
+                             : alphabeta(choose, oppof(next), beta - 1, beta, true, reduced);
+            if (stopped or (ismax ? res.score <= alpha : res.score >= beta))
+                return res;
+            stats.lmr_researches++;
+        }
+        return alphabeta(choose, oppof(next), alpha, beta, not ismax, depth - 1);
+    }
 
-            // win
-            if (states[choose.x][choose.y].has_category(next, FIVE))
+    // Searches forcing moves only: our fives and fours, and the block of the
+    // opponent's five. Anything else stands pat on the static eval.
+    search_res_t quiesce(point_t last_move, gomoku_chess next, int alpha, int beta, bool ismax, int qdepth)
+    {
+        // the first node is the horizon node, already counted by alphabeta
+        if (qdepth == 0)
+            qs_root_nodes = 0;
+        else
+            count_node();
+        stats.qs_nodes++;
+        qs_root_nodes++;
+
+        if (stopped)
+            return search_res_t(0, 0, last_move);
+
+        if (qdepth >= config.qs_max_depth or qs_root_nodes >= config.qs_node_limit)
+        {
+            stats.qs_limit_hits++;
+            return search_res_t(0, static_eval(), last_move);
+        }
+
+        std::vector<point_t> me_four, op_five;
+        for (int i = 0; i < 15; i++)
+        {
+            for (int j = 0; j < 15; j++)
             {
-                auto res = search_res_t(depth, score_lose, choose);
-                zob_table.insert_or_assign(zob, res);
-                setchess(choose, EMPTY);
-                return res;
+                auto & state = states[i][j];
+                if (board.getchess(i, j) != EMPTY or not state.has_neighbor())
+                    continue;
+
+                auto we_have = state.cats_for(next);
+                auto op_have = state.cats_for(oppof(next));
+
+                if (we_have[FIVE])
+                    return search_res_t(0, ismax ? score_win : score_lose, point_t{i, j});
+                if (op_have[FIVE])
+                    op_five.push_back({i, j});
+                if (we_have[FLEX4])
+                    me_four.insert(me_four.begin(), point_t{i, j});
+                else if (we_have[BLOCK4])
+                    me_four.push_back({i, j});
             }
+        }
 
-            auto res = alphabeta(choose, oppof(next), alpha, beta, true, depth - 1);
+        // two fives can't both be blocked
+        if (op_five.size() > 1)
+            return search_res_t(0, ismax ? score_lose : score_win, op_five[0]);
 
-            if(res.score < score)
+        int score;
+        std::vector<point_t> chooses;
+        if (not op_five.empty())
+        {
+            score = ismax ? score_lose : score_win;
+            chooses = op_five;
+        }
+        else
+        {
+            score = static_eval();
+            if (ismax ? score >= beta : score <= alpha)
             {
-                bestpos = choose;
-                bestzob = zob;
+                stats.qs_stand_pats++;
+                return search_res_t(0, score, last_move);
             }
+            chooses = me_four;
+        }
 
-            setchess(choose, EMPTY);
+        for (auto & choose : chooses)
+        {
+            if (ismax)
+                alpha = std::max(alpha, score);
+            else
+                beta = std::min(beta, score);
+            if (beta <= alpha)
+                break;
 
-            score = std::min(score, res.score);
-            beta = std::min(beta, score);
+            setchess(choose, next);
+            auto res = quiesce(choose, oppof(next), alpha, beta, not ismax, qdepth + 1);
+            setchess(choose, EMPTY);
 
-            if(beta <= alpha)
-                break;
+            score = ismax ? std::max(score, res.score) : std::min(score, res.score);
         }
-        auto res = search_res_t(depth, score, bestpos);
-        zob_table.insert_or_assign(bestzob, res);
-        return res;
+        return search_res_t(0, score, last_move);
     }
 
-    void reset_board(gomoku_board const& _board)
+    void report_progress()
     {
-        for(int i = 0; i < 15; i++)
-            for(int j = 0; j < 15; j++)
-                board.chesses[i][j] = _board.chesses[i][j];
+        progress.nodes = stats.nodes;
+        progress.ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - search_start).count();
+        limits->on_progress(progress);
     }
 
-    void reset_states()
+    // Counts a node of alphabeta or quiesce and checks every limit on the
+    // search.
+    void count_node()
     {
-        for(int i = 0; i < 15; i++)
-            for(int j = 0; j < 15; j++)
-                states[i][j] = get_state(board, i, j);
+        stats.nodes++;
+
+        if (node_limit and stats.nodes >= node_limit)
+            stopped = true;
+
+        if (yield_at and stats.nodes >= yield_at)
+            stopped = yielded = true;
+
+        if (analysis_cancel and stats.nodes % 256 == 0 and analysis_cancel->load(std::memory_order_relaxed))
+            stopped = true;
+
+        if (limits)
+            poll_limits();
     }
 
-    void reset_zob()
+    // Checked at every node of an iterative deepening search.
+    void poll_limits()
     {
-        for(int i = 0; i < 15; i++)
-            for(int j = 0; j < 15; j++)
-                zob[i][j] = zobrist_val(i, j, board.getchess(i, j));
+        if (progress.depth > 0 and limits->cancel and limits->cancel->load(std::memory_order_relaxed))
+            stopped = true;
+
+        if (limits->on_progress and limits->progress_interval > 0 and
+            stats.nodes % limits->progress_interval == 0)
+            report_progress();
+
+        if (progress.depth > 0 and stats.nodes % 1024 == 0 and timer.hard_expired())
+        {
+            timer.stop(STOP_HARD);
+            stopped = true;
+        }
     }
 
-    void reset_tracker()
+    // Follows the best moves stored in the transposition table.
+    std::vector<point_t> extract_pv(gomoku_chess next, int max_len)
     {
-        cache_hit = 0;
-        for (int i = 0; i < 50; i++)
-            depth_tracker[i] = 0;
+        std::vector<point_t> pv;
+
+        while ((int)pv.size() < max_len)
+        {
+            auto key = zob.canonical();
+            tt_entry_t e;
+            if (not tt_probe(key.first, e))
+                break;
+            point_t p = transform(e.p, inverse_sym(key.second));
+            if (board.getchess(p) != EMPTY)
+                break;
+            pv.push_back(p);
+            setchess(p, next);
+            bool won = states[p.x][p.y].has_category(next, FIVE);
+            next = oppof(next);
+            if (won)
+                break;
+        }
+
+        for (auto it = pv.rbegin(); it != pv.rend(); it++)
+            setchess(*it, EMPTY);
+        return pv;
     }
 
-    point_t get_next(gomoku_board const& _board)
+    // Plays `p` for us on the current board and scores it with a full window.
+    root_move_t score_root_move(point_t p, int depth)
     {
-        static const int max_depth = 6;
+        root_move_t res{p, 0, {p}};
+
+        setchess(p, mine);
+        if (states[p.x][p.y].has_category(mine, FIVE))
+        {
+            res.score = score_win;
+        }
+        else
+        {
+            root_depth = depth;
+            res.score = alphabeta(p, oppof(mine), score_lose, score_win, false, depth - 1).score;
+            auto pv = extract_pv(oppof(mine), depth - 1);
+            res.pv.insert(res.pv.end(), pv.begin(), pv.end());
+        }
+        setchess(p, EMPTY);
+        return res;
+    }
 
+    // Scores every root candidate on the pool's workers, best first. Setting
+    // `*cancel` stops the workers; nothing is returned then.
+    std::vector<root_move_t> score_root_moves(gomoku_board const& _board, int depth, thread_pool & pool,
+                                              const std::atomic<bool> *cancel = nullptr)
+    {
         reset_board(_board);
         reset_states();
         reset_zob();
         reset_tracker();
-        
-        auto res = alphabeta({0, 0}, mine, score_lose, score_win, true, max_depth);
 
-        int node_total = 0;
-        for (int i = 0; i <= max_depth; i++)
+        auto chooses = gen_chooses(board, mine);
+
+        // settings are copied on every call, they may have changed since the
+        // helpers were made
+        while ((int)helpers.size() < pool.size())
+            helpers.push_back(std::make_unique<gomoku_ai>(mine));
+        for (int i = 0; i < pool.size(); i++)
         {
-            node_total += depth_tracker[i];
-            logger << "depth" << "[" << i << "]: " << depth_tracker[i] << ' ';
+            auto & h = *helpers[i];
+            h.set_config(config);
+            h.set_network(network);
+            h.set_shared_table(shared_table);
+            h.analysis_cancel = cancel;
+            h.reset_board(_board);
+            h.reset_states();
+            h.reset_zob();
+            h.reset_network();
+            h.reset_tracker();
         }
-        logger << std::endl;
 
-        logger << "node total: " << node_total
-               << " cache hit: " << cache_hit
-               << " hit rate " << (double)cache_hit / (double)node_total
-               << std::endl;
+        std::vector<root_move_t> moves(chooses.size());
+        pool.parallel_for(chooses.size(), [&](int worker, size_t i)
+        {
+            moves[i] = helpers[worker]->score_root_move(chooses[i], depth);
+        });
+        // the helpers also serve mcts_search, and `cancel` may not outlive
+        // this call
+        for (int i = 0; i < pool.size(); i++)
+        {
+            helpers[i]->analysis_cancel = nullptr;
+            helpers[i]->stopped = false;
+        }
+        if (cancel and cancel->load(std::memory_order_relaxed))
+            return {};
+
+        std::ranges::stable_sort(moves, [](root_move_t const& m1, root_move_t const& m2) { return m1.score > m2.score; });
+        return moves;
+    }
+
+    bool states_consistent()
+    {
+        for (int i = 0; i < 15; i++)
+            for (int j = 0; j < 15; j++)
+                if (not state_equal(states[i][j], get_state(board, i, j)))
+                    return false;
+        return true;
+    }
+
+    void perft_walk(gomoku_chess next, int depth, bool verify, perft_res_t & res)
+    {
+        res.nodes++;
+        if (verify and not states_consistent())
+            res.mismatches++;
+
+        if (depth == 0)
+        {
+            res.leaves++;
+            return;
+        }
 
-        logger.flush();
+        auto chooses = gen_chooses(board, next);
+        if (chooses.empty())
+        {
+            res.leaves++;
+            return;
+        }
+
+        for (auto choose : chooses)
+        {
+            setchess(choose, next);
+            if (states[choose.x][choose.y].has_category(next, FIVE))
+            {
+                res.nodes++;
+                res.leaves++;
+            }
+            else
+                perft_walk(oppof(next), depth - 1, verify, res);
+            setchess(choose, EMPTY);
+        }
+    }
+
+    // Value of a leaf for the player who moved into it.
+    float mcts_leaf_value(gomoku_chess next)
+    {
+        int eval = static_eval();
+        if (next == mine)
+            eval = -eval;
+        return std::tanh(eval / config.mcts_value_scale);
+    }
+
+    // Called by the one thread that won the node's expansion.
+    float mcts_expand(mcts_tree & tree, mcts_node & node, gomoku_chess next)
+    {
+        auto chooses = gen_chooses(board, next);
+        uint32_t first = chooses.empty() ? 0 : tree.allocate(chooses.size());
+        if (not chooses.empty() and first == 0)
+        {
+            node.state.store(MCTS_LEAF, std::memory_order_release);
+            return mcts_leaf_value(next);
+        }
+
+        // a softmax over the attack and defence ranks of the moves
+        std::vector<float> priors(chooses.size());
+        float max_rank = 0, sum = 0;
+        for (size_t i = 0; i < chooses.size(); i++)
+        {
+            auto & state = states[chooses[i].x][chooses[i].y];
+            priors[i] = (state.rankof(next) + state.rankof(oppof(next))) / config.mcts_prior_temperature;
+            max_rank = std::max(max_rank, priors[i]);
+        }
+        for (auto & prior : priors)
+            sum += prior = std::exp(prior - max_rank);
+
+        bool next_wins = false;
+        mcts_node *children = tree.at(first);
+        for (size_t i = 0; i < chooses.size(); i++)
+        {
+            auto p = chooses[i];
+            bool wins = states[p.x][p.y].has_category(next, FIVE);
+            children[i].init(p, priors[i] / sum, wins);
+            next_wins = next_wins or wins;
+        }
+
+        node.first_child = first;
+        node.child_count = chooses.size();
+        node.state.store(MCTS_EXPANDED, std::memory_order_release);
+
+        if (next_wins)
+            return -1;
+        return chooses.empty() ? 0 : mcts_leaf_value(next);
+    }
+
+    // One playout from the root, which is this engine's board and left as it
+    // was. Returns the length of the path.
+    int mcts_playout(mcts_tree & tree, std::vector<mcts_node *> & path)
+    {
+        const int loss = config.mcts_virtual_loss;
+
+        path.clear();
+        mcts_node *node = &tree.root();
+        gomoku_chess next = mine;
+
+        // the value for the player who moved into `node`
+        float value;
+        for (;;)
+        {
+            if (node->wins)
+            {
+                value = 1;
+                break;
+            }
+
+            uint8_t state = node->state.load(std::memory_order_acquire);
+            if (state == MCTS_UNEXPANDED and
+                node->state.compare_exchange_strong(state, MCTS_EXPANDING, std::memory_order_acquire))
+            {
+                value = mcts_expand(tree, *node, next);
+                break;
+            }
+
+            // another thread is expanding it, or the tree is full
+            if (state != MCTS_EXPANDED)
+            {
+                value = mcts_leaf_value(next);
+                break;
+            }
+
+            // the board is full
+            if (node->child_count == 0)
+            {
+                value = 0;
+                break;
+            }
+
+            // counts as `loss` lost visits until backed up, which steers the
+            // other threads to different lines
+            auto & child = tree.select(*node, config.mcts_cpuct);
+            child.visits.fetch_add(loss, std::memory_order_relaxed);
+            child.value.fetch_sub(loss, std::memory_order_relaxed);
+
+            setchess(child.move, next);
+            path.push_back(&child);
+            node = &child;
+            next = oppof(next);
+        }
+
+        for (auto it = path.rbegin(); it != path.rend(); it++)
+        {
+            (*it)->visits.fetch_add(1 - loss, std::memory_order_relaxed);
+            (*it)->value.fetch_add(value + loss, std::memory_order_relaxed);
+            value = -value;
+            setchess((*it)->move, EMPTY);
+        }
+        tree.root().visits.fetch_add(1, std::memory_order_relaxed);
+        return path.size();
+    }
+
+    search_res_t mcts_search(gomoku_board const& _board, search_limits const& _limits)
+    {
+        reset_board(_board);
+        reset_states();
+        reset_zob();
+        reset_network();
+        reset_tracker();
+
+        int threads = std::max(config.mcts_threads, 1);
+        if (not mcts_pool or mcts_pool->size() != threads)
+            mcts_pool = std::make_unique<thread_pool>(threads);
+
+        while ((int)helpers.size() < threads)
+            helpers.push_back(std::make_unique<gomoku_ai>(mine));
+        for (int i = 0; i < threads; i++)
+        {
+            auto & h = *helpers[i];
+            h.set_config(config);
+            h.set_network(network);
+            h.set_shared_table(shared_table);
+            h.reset_board(_board);
+            h.reset_states();
+            h.reset_zob();
+            h.reset_network();
+        }
+
+        tree.reset(config.mcts_tree_nodes);
+        search_start = std::chrono::steady_clock::now();
+
+        const long budget = _limits.max_nodes ? _limits.max_nodes : config.mcts_playouts;
+        std::atomic<long> playouts = 0;
+        std::atomic<int> max_depth = 0;
+
+        mcts_pool->parallel_for(threads, [&](int worker, size_t)
+        {
+            auto & h = *helpers[worker];
+            std::vector<mcts_node *> path;
+            for (long n = playouts++; n < budget; n = playouts++)
+            {
+                int depth = h.mcts_playout(tree, path);
+                for (int d = max_depth; d < depth and not max_depth.compare_exchange_weak(d, depth); )
+                    ;
+
+                bool expanded = tree.root().state.load(std::memory_order_acquire) == MCTS_EXPANDED;
+                if (expanded and _limits.cancel and _limits.cancel->load(std::memory_order_relaxed))
+                    break;
+
+                if (worker == 0 and _limits.on_progress and _limits.progress_interval > 0 and
+                    n % _limits.progress_interval == 0)
+                {
+                    auto best = mcts_best();
+                    _limits.on_progress(search_progress{max_depth, std::min(playouts.load(), budget),
+                        std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - search_start).count(),
+                        best.score, best.p});
+                }
+            }
+        });
+
+        stats.nodes = std::min(playouts.load(), budget);
+        auto best = mcts_best();
+        best.depth = max_depth;
+        return best;
+    }
+
+    // The most visited root move.
+    search_res_t mcts_best()
+    {
+        auto & root = tree.root();
+        if (root.state.load(std::memory_order_acquire) != MCTS_EXPANDED or root.child_count == 0)
+            return search_res_t(0, 0, {7, 7});
+
+        mcts_node *children = tree.children(root);
+        mcts_node *best = children;
+        for (uint32_t i = 1; i < root.child_count; i++)
+        {
+            if (children[i].visits.load(std::memory_order_relaxed) > best->visits.load(std::memory_order_relaxed))
+                best = &children[i];
+        }
+        if (best->wins)
+            return search_res_t(0, score_win, best->move);
+
+        int visits = std::max(best->visits.load(std::memory_order_relaxed), 1);
+        float q = std::clamp(best->value.load(std::memory_order_relaxed) / visits, -0.999f, 0.999f);
+        return search_res_t(0, std::atanh(q) * config.mcts_value_scale, best->move);
+    }
+
+    bool tt_probe(uint64_t key, tt_entry_t & e)
+    {
+        NARA_PERF_SCOPE(perf, REGION_TT_PROBE);
+
+        if (zob_table.empty())
+            return false;
+        auto const& slot = zob_table[key & (tt_slots - 1)];
+        if (slot.key != key)
+            return false;
+        e = slot.entry;
+        return true;
+    }
+
+    void tt_put(uint64_t key, tt_entry_t const& e)
+    {
+        if (zob_table.empty())
+            zob_table.resize(tt_slots);
+        zob_table[key & (tt_slots - 1)] = tt_slot_t{key, e};
+    }
+
+    void tt_store(std::pair<uint64_t, int> key, int depth, int score, int alpha, int beta, point_t p)
+    {
+        if (stopped)
+            return;
+        bound_t bound = (score <= alpha) ? UPPER : (score >= beta) ? LOWER : EXACT;
+        tt_put(key.first, tt_entry_t{depth, score, bound, transform(p, key.second)});
+    }
+
+    // Proven results are shared from the side to move's point of view, since
+    // other processes may search for the other colour.
+    bool shared_probe(std::pair<uint64_t, int> key, gomoku_chess next, search_res_t & res)
+    {
+        shared_result_t r;
+        if (not shared_table or not shared_table->probe(key.first, r))
+            return false;
+        bool mine_wins = (next == mine) == r.win;
+        res = search_res_t(r.depth, mine_wins ? score_win : score_lose, transform(r.p, inverse_sym(key.second)));
+        return true;
+    }
+
+    void shared_store(std::pair<uint64_t, int> key, gomoku_chess next, int depth, int score, int alpha, int beta, point_t p)
+    {
+        if (not shared_table or stopped)
+            return;
+        bool proven = (score == score_win and score > alpha) or (score == score_lose and score < beta);
+        if (not proven)
+            return;
+        bool next_wins = (score == score_win) == (next == mine);
+        shared_table->store(key.first, shared_result_t{next_wins, depth, transform(p, key.second)});
+    }
+
+    search_res_t
+    alphabeta_node(point_t last_move, gomoku_chess next, int alpha, int beta, bool ismax, int depth)
+    {
+        if (stopped)
+            return search_res_t(depth, 0, last_move);
+
+        if (depth < 50) depth_tracker[depth]++;
+        count_node();
+
+        auto key = zob.canonical();
+        const int alpha_orig = alpha;
+        const int beta_orig = beta;
+
+        // cache hit
+        if (tt_entry_t e; tt_probe(key.first, e))
+        {
+            if (e.depth >= depth and (e.bound == EXACT or
+                                      (e.bound == LOWER and e.score >= beta) or
+                                      (e.bound == UPPER and e.score <= alpha)))
+            {
+                cache_hit++;
+                if (recorder)
+                    recorder->current().flags |= TREE_TT_HIT;
+                return search_res_t(e.depth, e.score, transform(e.p, inverse_sym(key.second)));
+            }
+        }
+
+        if (search_res_t res(0, 0, {}); shared_probe(key, next, res))
+        {
+            shared_hit++;
+            if (recorder)
+                recorder->current().flags |= TREE_SHARED_HIT;
+            return res;
+        }
+
+        if (depth == 0)
+        {
+            if (recorder)
+                recorder->current().flags |= TREE_LEAF;
+            if (config.quiescence)
+                return quiesce(last_move, next, alpha, beta, ismax, 0);
+            return search_res_t(depth, static_eval(), last_move);
+        }
+
+        // null move: pass, and cut if the opponent still can't reach the window
+        if (config.null_move and not in_null and depth < root_depth and depth > config.null_reduction and
+            not can_make(next, FIVE) and not can_make(oppof(next), FLEX4))
+        {
+            stats.null_tries++;
+            in_null = true;
+            zob.toggle_side();
+            auto res = ismax ? alphabeta(last_move, oppof(next), beta - 1, beta, false, depth - 1 - config.null_reduction)
+                             : alphabeta(last_move, oppof(next), alpha, alpha + 1, true, depth - 1 - config.null_reduction);
+            zob.toggle_side();
+            in_null = false;
+
+            if (stopped)
+                return res;
+
+            if (ismax ? res.score >= beta : res.score <= alpha)
+            {
+                stats.null_cutoffs++;
+                if (recorder)
+                    recorder->current().flags |= TREE_NULL_CUT;
+                return search_res_t(depth, res.score, last_move);
+            }
+        }
+
+        auto chooses = gen_chooses(board, next);
+        if (recorder)
+            recorder->current().moves = std::min<size_t>(chooses.size(), 255);
+
+        bool futile = false;
+        if (config.futility and depth < (int)config.futility_margin.size())
+        {
+            int margin = config.futility_margin[depth];
+            int eval = static_eval();
+            futile = ismax ? eval + margin <= alpha : eval - margin >= beta;
+        }
+
+        // if (chooses.size() == 1)
+        // {
+        //     setchess(chooses[0], next);
+        //     auto res = alphabeta(chooses[0], oppof(next), alpha, beta, false, 0);
+        //     setchess(chooses[0], EMPTY);
+        //     return res;
+        // }
+
+        point_t bestpos = chooses[0];
+
+        bool forced = config.extensions and states[bestpos.x][bestpos.y].has_category(oppof(next), FIVE);
+
+        point_t singular_move{-1, -1};
+        if (config.singular_extension and not in_null and depth >= config.singular_min_depth and chooses.size() > 1)
+        {
+            tt_entry_t e;
+            if (tt_probe(key.first, e) and e.depth >= depth - 3 and
+                (e.bound == EXACT or e.bound == (ismax ? LOWER : UPPER)) and
+                e.score != score_win and e.score != score_lose)
+            {
+                auto p = transform(e.p, inverse_sym(key.second));
+                if (std::ranges::find(chooses, p) != chooses.end() and
+                    is_singular(p, chooses, next, ismax, depth, e.score))
+                {
+                    stats.singular_extensions++;
+                    singular_move = p;
+                }
+                if (stopped)
+                    return search_res_t(depth, 0, last_move);
+            }
+        }
+
+        if (ismax)
+        {
+            int score = score_lose;
+            for (int index = 0; index < (int)chooses.size(); index++)
+            {
+                auto & choose = chooses[index];
+                bool quiet = is_quiet(choose);
+
+                if (futile and index > 0 and quiet)
+                {
+                    stats.futility_prunes++;
+                    continue;
+                }
+
+                setchess(choose, next);
+                if (recorder)
+                    recorder->current().searched++;
+
+                // win
+                if (states[choose.x][choose.y].has_category(next, FIVE))
+                {
+                    setchess(choose, EMPTY);
+                    if (recorder)
+                        recorder->current().cutoff = index;
+                    tt_store(key, depth, score_win, alpha_orig, beta_orig, choose);
+                    shared_store(key, next, depth, score_win, alpha_orig, beta_orig, choose);
+                    return search_res_t(depth, score_win, choose);
+                }
+
+                int ext = extension_of(choose, next, forced, singular_move);
+                bool reduce = config.late_move_reduction and quiet and not ext and
+                              depth >= config.lmr_min_depth and index >= config.lmr_min_index;
+                stats.extensions += ext;
+                path_extensions += ext;
+                auto res = search_move(choose, next, alpha, beta, true, depth + ext, reduce);
+                path_extensions -= ext;
+
+                if(res.score > score)
+                    bestpos = choose;
+
+                setchess(choose, EMPTY);
+
+                if (stopped)
+                    return search_res_t(depth, score, bestpos);
+
+                score = std::max(score, res.score);
+                alpha = std::max(alpha, score);
+
+                if(beta <= alpha)
+                {
+                    if (recorder)
+                        recorder->current().cutoff = index;
+                    break;
+                }
+            }
+            tt_store(key, depth, score, alpha_orig, beta_orig, bestpos);
+            shared_store(key, next, depth, score, alpha_orig, beta_orig, bestpos);
+            return search_res_t(depth, score, bestpos);
+        }
+
+        // ismin
+        int score = score_win;
+        for (int index = 0; index < (int)chooses.size(); index++)
+        {
+            auto & choose = chooses[index];
+            bool quiet = is_quiet(choose);
+
+            if (futile and index > 0 and quiet)
+            {
+                stats.futility_prunes++;
+                continue;
+            }
+
+            setchess(choose, next);
+            if (recorder)
+                recorder->current().searched++;
+
+            // win
+            if (states[choose.x][choose.y].has_category(next, FIVE))
+            {
+                setchess(choose, EMPTY);
+                if (recorder)
+                    recorder->current().cutoff = index;
+                tt_store(key, depth, score_lose, alpha_orig, beta_orig, choose);
+                shared_store(key, next, depth, score_lose, alpha_orig, beta_orig, choose);
+                return search_res_t(depth, score_lose, choose);
+            }
+
+            int ext = extension_of(choose, next, forced, singular_move);
+            bool reduce = config.late_move_reduction and quiet and not ext and
+                          depth >= config.lmr_min_depth and index >= config.lmr_min_index;
+            stats.extensions += ext;
+            path_extensions += ext;
+            auto res = search_move(choose, next, alpha, beta, false, depth + ext, reduce);
+            path_extensions -= ext;
+
+            if(res.score < score)
+                bestpos = choose;
+
+            setchess(choose, EMPTY);
+
+            if (stopped)
+                return search_res_t(depth, score, bestpos);
+
+            score = std::min(score, res.score);
+            beta = std::min(beta, score);
+
+            if(beta <= alpha)
+            {
+                if (recorder)
+                    recorder->current().cutoff = index;
+                break;
+            }
+        }
+        tt_store(key, depth, score, alpha_orig, beta_orig, bestpos);
+        shared_store(key, next, depth, score, alpha_orig, beta_orig, bestpos);
+        return search_res_t(depth, score, bestpos);
+    }
+
+  public:
+    gomoku_ai(gomoku_chess chess): mine(chess) {}
+
+    search_res_t
+    alphabeta(point_t last_move, gomoku_chess next, int alpha, int beta, bool ismax, int depth)
+    {
+        if (not recorder)
+            return alphabeta_node(last_move, next, alpha, beta, ismax, depth);
+
+        uint8_t flags = (in_null ? TREE_NULL : 0) | (singular_nesting ? TREE_VERIFY : 0);
+        recorder->enter(last_move, depth, alpha, beta, ismax, flags);
+        auto res = alphabeta_node(last_move, next, alpha, beta, ismax, depth);
+        recorder->leave(res.score, stopped);
+        return res;
+    }
+
+    void reset_board(gomoku_board const& _board)
+    {
+        synced = false;
+        board = _board;
+    }
+
+    void reset_states()
+    {
+        for(int i = 0; i < 15; i++)
+            for(int j = 0; j < 15; j++)
+                states[i][j] = get_state(board, i, j);
+    }
+
+    void reset_zob()
+    {
+        zob = symmetric_key::of(board);
+    }
+
+    void reset_network()
+    {
+        if (network)
+            network->reset(accumulator, board);
+    }
+
+    // Brings the board, states, keys and accumulator to `_board`. A position
+    // a few stones from the current one, such as the next move of the same
+    // game or the position of a restored snapshot, is reached with make and
+    // unmake instead of rebuilding every state.
+    void sync_position(gomoku_board const& _board)
+    {
+        const int max_changes = 8;
+
+        point_t changed[max_changes];
+        int changes = 0;
+        for (int i = 0; i < 15 and synced; i++)
+        {
+            for (int j = 0; j < 15; j++)
+            {
+                if (board.getchess(i, j) == _board.getchess(i, j))
+                    continue;
+                if (changes < max_changes)
+                    changed[changes] = {i, j};
+                changes++;
+            }
+        }
+
+        if (not synced or changes > max_changes)
+        {
+            reset_board(_board);
+            reset_states();
+            reset_zob();
+            reset_network();
+            synced = true;
+            return;
+        }
+
+        for (int k = 0; k < changes; k++)
+        {
+            auto p = changed[k];
+            if (board.getchess(p) != EMPTY)
+                setchess(p, EMPTY);
+            if (_board.getchess(p) != EMPTY)
+                setchess(p, _board.getchess(p));
+        }
+    }
+
+    // Saves the position and the `tt_entries` deepest transposition table
+    // entries, see snapshot.hpp.
+    std::vector<uint8_t> snapshot(size_t tt_entries = 0) const
+    {
+        std::vector<std::pair<uint64_t, tt_entry_t>> hot;
+        for (auto const& slot : zob_table)
+        {
+            if (slot.key)
+                hot.emplace_back(slot.key, slot.entry);
+        }
+        tt_entries = std::min(tt_entries, hot.size());
+        auto deeper = [](auto const& a, auto const& b) { return a.second.depth > b.second.depth; };
+        std::nth_element(hot.begin(), hot.begin() + tt_entries, hot.end(), deeper);
+        hot.resize(tt_entries);
+
+        snapshot_header header{};
+        std::memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+        header.version = snapshot_version;
+        header.tt_count = hot.size();
+        header.seed = zobrist_seed;
+        header.mine = mine;
+
+        std::vector<uint8_t> out;
+        out.reserve(sizeof(header) + 15 * 15 + hot.size() * sizeof(snapshot_tt_entry));
+        detail::put_raw(out, header);
+        for (int i = 0; i < 15; i++)
+            for (int j = 0; j < 15; j++)
+                out.push_back(board.getchess(i, j));
+
+        for (auto const& [key, e] : hot)
+        {
+            snapshot_tt_entry t{};
+            t.key = key;
+            t.score = e.score;
+            t.depth = std::clamp(e.depth, -128, 127);
+            t.bound = e.bound;
+            t.move = e.p.x * 15 + e.p.y;
+            detail::put_raw(out, t);
+        }
+        return out;
+    }
+
+    // Replaces the position and the transposition table with a snapshot's.
+    // The states, keys and accumulator are rebuilt from the board rather
+    // than read from the blob. False, with the engine unchanged, if the blob
+    // is damaged or from an incompatible build or the other colour's engine.
+    bool restore(std::span<const uint8_t> blob)
+    {
+        snapshot_header header;
+        if (not detail::get_raw(blob, header) or
+            std::memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) != 0 or
+            header.version != snapshot_version or
+            header.seed != zobrist_seed or header.mine != mine or
+            blob.size() != 15 * 15 + uint64_t(header.tt_count) * sizeof(snapshot_tt_entry))
+            return false;
+
+        auto cells = blob.first(15 * 15);
+        for (uint8_t c : cells)
+        {
+            if (c > WHITE)
+                return false;
+        }
+
+        std::vector<snapshot_tt_entry> entries(header.tt_count);
+        auto rest = blob.subspan(15 * 15);
+        for (auto & t : entries)
+        {
+            if (not detail::get_raw(rest, t) or t.move >= 15 * 15 or t.bound > UPPER)
+                return false;
+        }
+
+        for (int i = 0; i < 15 * 15; i++)
+            board.setchess(i / 15, i % 15, gomoku_chess(cells[i]));
+        reset_states();
+        reset_zob();
+        reset_network();
+        synced = true;
+
+        clear_table();
+        for (auto const& t : entries)
+        {
+            if (t.key)
+                tt_put(t.key, tt_entry_t{t.depth, t.score, bound_t(t.bound), {t.move / 15, t.move % 15}});
+        }
+        return true;
+    }
+
+    // Forgets every transposition table entry, e.g. before an unrelated game.
+    void clear_table()
+    {
+        std::ranges::fill(zob_table, tt_slot_t{});
+    }
+
+    void reset_tracker()
+    {
+        cache_hit = 0;
+        shared_hit = 0;
+        stats = search_stats_t{};
+        perf.reset();
+        for (int i = 0; i < 50; i++)
+            depth_tracker[i] = 0;
+
+        // untimed, and no report, unless the search starts the clock
+        timer.start(0, 0, false);
+    }
+
+    void set_book(const opening_book *_book) { book = _book; }
+
+    void set_shared_table(shared_result_table *_table) { shared_table = _table; }
+
+    void set_log(std::ostream *_log) { log = _log; }
+
+    // Records every node alphabeta visits into `_recorder`, nullptr to stop.
+    void set_recorder(tree_recorder *_recorder) { recorder = _recorder; }
+
+    void set_config(search_config const& _config) { config = _config; }
+
+    // The `multipv` best moves with their scores and principal variations.
+    // Setting `*cancel` abandons the analysis, see score_root_moves.
+    std::vector<root_move_t> analyse(gomoku_board const& _board, int depth, int multipv, thread_pool & pool,
+                                     const std::atomic<bool> *cancel = nullptr)
+    {
+        auto moves = score_root_moves(_board, depth, pool, cancel);
+        if ((int)moves.size() > multipv)
+            moves.resize(multipv);
+        return moves;
+    }
+
+    // The score of every root candidate, no_score elsewhere.
+    heatmap_t heatmap(gomoku_board const& _board, int depth, thread_pool & pool)
+    {
+        heatmap_t map;
+        for (auto & row : map)
+            row.fill(no_score);
+        for (auto & m : score_root_moves(_board, depth, pool))
+            map[m.p.x][m.p.y] = m.score;
+        return map;
+    }
+
+    // Evaluates leaves with `_network` instead of the pattern ranks.
+    void set_network(const nnue_network *_network)
+    {
+        network = (_network and _network->loaded()) ? _network : nullptr;
+        synced = false;
+    }
+
+    search_stats_t const& get_stats() const { return stats; }
+
+    perf_profile const& get_perf() const { return perf; }
+
+    // How the time of the last timed search was spent.
+    time_report const& get_time_report() const { return timer.report(); }
+
+    // Visits every line gen_chooses allows to `depth` plies with make/unmake
+    // only, no evaluation or pruning; a move that makes five ends its line.
+    // With `verify`, every node's states are compared with get_state.
+    perft_res_t perft(gomoku_board const& _board, gomoku_chess next, int depth, bool verify)
+    {
+        reset_board(_board);
+        reset_states();
+        reset_zob();
+        reset_network();
+
+        perft_res_t res;
+        perft_walk(next, depth, verify, res);
+        return res;
+    }
+
+    search_res_t search(gomoku_board const& _board, int depth)
+    {
+        if (config.backend == MCTS)
+            return mcts_search(_board, search_limits{});
+
+        sync_position(_board);
+        reset_tracker();
+
+        root_depth = depth;
+        return alphabeta({0, 0}, mine, score_lose, score_win, true, depth);
+    }
+
+    // Iterative deepening within `limits`; returns the result of the deepest
+    // completed iteration.
+    search_res_t search(gomoku_board const& _board, search_limits const& _limits)
+    {
+        if (config.backend == MCTS)
+            return mcts_search(_board, _limits);
+
+        auto steps = search_steps(_board, _limits, 0);
+        while (steps.step())
+            ;
+        return steps.value();
+    }
+
+    // The same search as a coroutine that pauses every `slice` nodes (never
+    // if 0), so that one thread can take turns between many engines. A paused
+    // iteration starts again from the root on resume and finds the subtrees
+    // it finished in the transposition table. Walking back to where it
+    // stopped isn't free, so every retry of an iteration gets the nodes of
+    // the attempt before it on top of `slice`, and always gets further. Each
+    // pause publishes the result of the deepest completed iteration; before
+    // the first one, depth 0 and the first generated move.
+    // The engine must not be used for anything else until the search ends or
+    // is destroyed.
+    resumable<search_res_t> search_steps(gomoku_board _board, search_limits _limits, long slice)
+    {
+        sync_position(_board);
+        reset_tracker();
+
+        // also runs when a paused search is destroyed
+        struct cleanup_t
+        {
+            gomoku_ai *ai;
+            ~cleanup_t()
+            {
+                ai->limits = nullptr;
+                ai->node_limit = 0;
+                ai->yield_at = 0;
+                ai->stopped = false;
+                ai->yielded = false;
+            }
+        } cleanup{this};
+
+        limits = &_limits;
+        search_start = std::chrono::steady_clock::now();
+        progress = search_progress{0, 0, 0, 0, {7, 7}};
+
+        // a single reply is played as soon as the first iteration has a score
+        timer.start(_limits.move_time_ms, _limits.max_time_ms, _limits.adaptive_time);
+        auto root_chooses = gen_chooses(board, mine);
+        int root_moves = timer.enabled() ? root_chooses.size() : 0;
+
+        search_res_t best(0, 0, {7, 7});
+        if (not root_chooses.empty())
+            best.p = root_chooses.front();
+
+        // nodes the last interrupted attempt at this iteration took
+        long replay = 0;
+        for (int depth = 1; depth <= _limits.max_depth; depth++)
+        {
+            root_depth = depth;
+            long attempt_start = stats.nodes;
+            yield_at = slice ? stats.nodes + replay + slice : 0;
+            auto res = alphabeta({0, 0}, mine, score_lose, score_win, true, depth);
+            if (yielded)
+            {
+                replay = stats.nodes - attempt_start;
+                stopped = false;
+                yielded = false;
+                co_yield best;
+                depth--;
+                continue;
+            }
+            replay = 0;
+            if (stopped)
+            {
+                timer.stop((node_limit and stats.nodes >= node_limit) ? STOP_NODES : STOP_CANCEL);
+                break;
+            }
+
+            best = res;
+            node_limit = _limits.max_nodes;
+
+            progress.depth = depth;
+            progress.score = res.score;
+            progress.best = res.p;
+            if (_limits.on_progress)
+                report_progress();
+
+            if (res.score == score_win or res.score == score_lose)
+            {
+                timer.stop(STOP_PROVEN);
+                break;
+            }
+
+            if (not timer.next_iteration(res.p, res.score, root_moves))
+                break;
+        }
+        timer.finish();
+        co_return best;
+    }
+
+    bool book_move(gomoku_board const& _board, point_t & p)
+    {
+        int score;
+        if (not book or not book->lookup(_board, p, score))
+            return false;
+
+        if (log)
+            *log << "book move: " << p << " score: " << score << std::endl;
+        return true;
+    }
+
+    void log_search(int max_depth)
+    {
+        if (not log)
+            return;
+
+        int node_total = 0;
+        for (int i = 0; i <= max_depth; i++)
+        {
+            node_total += depth_tracker[i];
+            *log << "depth" << "[" << i << "]: " << depth_tracker[i] << ' ';
+        }
+        *log << std::endl;
+
+        *log << "node total: " << node_total
+             << " cache hit: " << cache_hit
+             << " hit rate " << (double)cache_hit / (double)node_total
+             << " shared hit: " << shared_hit
+             << std::endl;
+
+        *log << "null: " << stats.null_cutoffs << "/" << stats.null_tries
+             << " lmr re-search: " << stats.lmr_researches << "/" << stats.lmr_reductions
+             << " futility pruned: " << stats.futility_prunes
+             << std::endl;
+
+        *log << "extensions: " << stats.extensions
+             << " singular: " << stats.singular_extensions << "/" << stats.singular_tests
+             << std::endl;
+
+        *log << "quiescence nodes: " << stats.qs_nodes
+             << " stand pat: " << stats.qs_stand_pats
+             << " limit hits: " << stats.qs_limit_hits
+             << std::endl;
+
+        if (auto const& t = timer.report(); t.target_ms > 0)
+        {
+            *log << "time: target " << t.target_ms << " ms"
+                 << " allocated " << t.allocated_ms << " ms"
+                 << " used " << t.used_ms << " ms"
+                 << " iterations " << t.iterations
+                 << " best changes " << t.best_changes
+                 << " stopped by " << time_stop_names[t.reason]
+                 << std::endl;
+        }
+
+        if (perf_enabled)
+            perf.report(*log);
+
+        log->flush();
+    }
+
+    point_t get_next(gomoku_board const& _board)
+    {
+        static const int max_depth = 6;
+
+        if (point_t p; book_move(_board, p))
+            return p;
+
+        auto res = search(_board, max_depth);
+        log_search(max_depth);
+        return res.p;
+    }
+
+    // Like get_next, but deepens iteratively within `_limits`, so it can be
+    // cancelled from another thread and reports its progress.
+    point_t get_next(gomoku_board const& _board, search_limits const& _limits)
+    {
+        if (point_t p; book_move(_board, p))
+            return p;
 
+        auto res = search(_board, _limits);
+        log_search(std::min(_limits.max_depth, 49));
         return res.p;
     }
 };
@@ -0,0 +1,188 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "archive.hpp"
+#include "board.hpp"
+#include "eval.hpp"
+
+// Converts games to and from the binary archive format.
+//
+//     nara_archive pack <archive> <text files...>
+//     nara_archive dump <archive> [first] [count]
+//     nara_archive stat <archive>
+//
+// pack reads move lists or Piskvork files (see archive.hpp); games without a
+// result get the one their moves reach. dump writes games back as move
+// lists, and stat streams the whole archive once and reports its speed.
+
+// Checks that every move lands on an empty cell, and fills in the result
+// when the text didn't give one.
+bool replay(nara::text_game & game)
+{
+    nara::gomoku_board board;
+    nara::gomoku_chess winner = nara::EMPTY;
+    for (size_t i = 0; i < game.moves.size(); i++)
+    {
+        nara::point_t p{game.moves[i] / 15, game.moves[i] % 15};
+        if (board.getchess(p) != nara::EMPTY)
+            return false;
+        board.setchess(p, (i % 2) ? nara::WHITE : nara::BLACK);
+        if (winner == nara::EMPTY)
+            winner = nara::get_winner(board, p);
+    }
+
+    if (not game.has_result)
+        game.result = (winner == nara::BLACK) ? nara::RESULT_BLACK : (winner == nara::WHITE) ? nara::RESULT_WHITE : nara::RESULT_DRAW;
+    return true;
+}
+
+int pack(std::string const& output, std::vector<std::string> const& inputs)
+{
+    nara::archive_writer writer;
+    if (not writer.open(output))
+    {
+        std::cerr << "can't open " << output << std::endl;
+        return 1;
+    }
+
+    long packed = 0, skipped = 0;
+    auto add = [&](nara::text_game & game)
+    {
+        if (not replay(game))
+        {
+            skipped++;
+            return;
+        }
+        nara::archive_game g;
+        g.result = game.result;
+        g.moves = game.moves;
+        if (writer.append(g))
+            packed++;
+        else
+            skipped++;
+    };
+
+    for (auto const& input : inputs)
+    {
+        std::ifstream in(input);
+        if (not in)
+        {
+            std::cerr << "can't open " << input << std::endl;
+            return 1;
+        }
+
+        nara::text_game game;
+        std::string line;
+        if (in.peek() == 'P')
+        {
+            if (nara::parse_psq(in, game))
+                add(game);
+            else
+                skipped++;
+            continue;
+        }
+
+        while (std::getline(in, line))
+        {
+            if (line.empty() or line[0] == '#')
+                continue;
+            if (nara::parse_move_list(line, game))
+                add(game);
+            else
+                skipped++;
+        }
+    }
+
+    if (not writer.close())
+    {
+        std::cerr << "failed to write " << output << std::endl;
+        return 1;
+    }
+    std::cout << "packed " << packed << " games, skipped " << skipped << std::endl;
+    return 0;
+}
+
+int dump(nara::archive_reader const& archive, size_t first, size_t count)
+{
+    nara::archive_game game;
+    for (size_t i = first; i < archive.size() and i - first < count; i++)
+    {
+        if (not archive.game(i, game))
+        {
+            std::cerr << "game " << i << " is truncated or damaged" << std::endl;
+            return 1;
+        }
+        std::cout << nara::format_move_list(game) << std::endl;
+    }
+    return 0;
+}
+
+int stat(nara::archive_reader const& archive)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    long games = 0, moves = 0, bad_moves = 0;
+    long results[3] = {};
+    uint64_t offset = archive.begin();
+    nara::archive_game game;
+    while (archive.read_at(offset, game))
+    {
+        games++;
+        moves += game.moves.size();
+        results[game.result % 3]++;
+        for (uint8_t m : game.moves)
+            bad_moves += (m >= 15 * 15);
+    }
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    secs = std::max(secs, 1e-9);
+
+    std::cout << games << " games of " << archive.size() << ", " << moves << " moves";
+    if (games)
+        std::cout << ", " << (double)moves / games << " per game";
+    std::cout << std::endl
+              << "black " << results[nara::RESULT_BLACK] << ", white " << results[nara::RESULT_WHITE]
+              << ", draw " << results[nara::RESULT_DRAW] << std::endl
+              << games / secs << " games/s, " << offset / secs / 1e6 << " MB/s" << std::endl;
+
+    if (bad_moves or games != (long)archive.size())
+    {
+        std::cerr << "corrupt archive: " << bad_moves << " moves off the board" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string command = (argc > 1) ? argv[1] : "";
+    if (argc < 3 or (command != "pack" and command != "dump" and command != "stat"))
+    {
+        std::cerr << "usage: " << argv[0] << " pack <archive> <text files...>" << std::endl
+                  << "       " << argv[0] << " dump <archive> [first] [count]" << std::endl
+                  << "       " << argv[0] << " stat <archive>" << std::endl;
+        return 1;
+    }
+
+    if (command == "pack")
+        return pack(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+
+    nara::archive_reader archive;
+    if (not archive.open(argv[2]))
+    {
+        std::cerr << "can't open " << argv[2] << std::endl;
+        return 1;
+    }
+
+    if (command == "dump")
+    {
+        size_t first = (argc > 3) ? std::atol(argv[3]) : 0;
+        size_t count = (argc > 4) ? std::atol(argv[4]) : archive.size();
+        return dump(archive, first, count);
+    }
+    return stat(archive);
+}
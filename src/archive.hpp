@@ -0,0 +1,396 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "board.hpp"
+#include "dataset.hpp"
+
+namespace nara
+{
+
+// Whole games, one byte per move. On disk: an archive_header, the games
+// back to back, then the block index, 8-byte aligned, with the file offset
+// of the first game of every `block_games` games. A game is
+//
+//     result          1 byte, game_result
+//     rules           1 byte, game_rules
+//     moves           2 bytes, number of moves
+//     black_rating    2 bytes, 0 if unknown
+//     white_rating    2 bytes
+//     moves           one byte per move, x * 15 + y, black first
+//
+// Games are found by seeking to their block and skipping at most
+// block_games - 1 games. All integers are little endian.
+
+enum game_rules : uint8_t
+{
+    RULES_FREESTYLE,
+    RULES_STANDARD,
+    RULES_RENJU,
+};
+
+struct archive_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t block_games;
+    uint64_t games;
+    uint64_t index_offset;
+};
+
+struct archive_game_header
+{
+    uint8_t result;
+    uint8_t rules;
+    uint16_t moves;
+    int16_t black_rating;
+    int16_t white_rating;
+};
+
+static_assert(sizeof(archive_header) == 32);
+static_assert(sizeof(archive_game_header) == 8);
+
+const char archive_magic[8] = {'N', 'A', 'R', 'A', 'G', 'A', 'M', 'E'};
+const uint32_t archive_version = 1;
+
+// A game as read from an archive; `moves` points into the mapped file.
+struct archive_game
+{
+    game_result result = RESULT_DRAW;
+    game_rules rules = RULES_FREESTYLE;
+    int black_rating = 0;
+    int white_rating = 0;
+    std::span<const uint8_t> moves;
+
+    point_t move(size_t i) const { return {moves[i] / 15, moves[i] % 15}; }
+
+    gomoku_chess player(size_t i) const { return (i % 2) ? WHITE : BLACK; }
+
+    // The position after the first `plies` moves.
+    gomoku_board position(size_t plies) const
+    {
+        gomoku_board board;
+        for (size_t i = 0; i < plies and i < moves.size(); i++)
+            board.setchess(move(i), player(i));
+        return board;
+    }
+};
+
+inline uint8_t encode_move(point_t p) { return p.x * 15 + p.y; }
+
+class archive_writer
+{
+  private:
+
+    std::ofstream out;
+    archive_header header{};
+    std::vector<uint64_t> index;
+    uint64_t offset = 0;
+
+  public:
+
+    archive_writer() = default;
+    archive_writer(archive_writer const&) = delete;
+    archive_writer& operator=(archive_writer const&) = delete;
+
+    ~archive_writer() { close(); }
+
+    bool open(std::string const& path, uint32_t block_games = 1024)
+    {
+        close();
+
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (not out)
+            return false;
+
+        std::memcpy(header.magic, archive_magic, sizeof(archive_magic));
+        header.version = archive_version;
+        header.block_games = std::max(block_games, 1u);
+        header.games = 0;
+        header.index_offset = 0;
+        index.clear();
+
+        // rewritten by close() once the counts are known
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        offset = sizeof(header);
+        return bool(out);
+    }
+
+    // False if the game is too long or the write failed.
+    bool append(archive_game const& game)
+    {
+        if (game.moves.size() > 0xffff)
+            return false;
+
+        if (header.games % header.block_games == 0)
+            index.push_back(offset);
+
+        archive_game_header h;
+        h.result = game.result;
+        h.rules = game.rules;
+        h.moves = game.moves.size();
+        h.black_rating = game.black_rating;
+        h.white_rating = game.white_rating;
+
+        out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char *>(game.moves.data()), game.moves.size());
+        offset += sizeof(h) + game.moves.size();
+        header.games++;
+        return bool(out);
+    }
+
+    // Writes the index and the final header. Returns false if any write
+    // failed.
+    bool close()
+    {
+        if (not out.is_open())
+            return true;
+
+        // the index is read in place, so it starts 8-byte aligned
+        while (offset % sizeof(uint64_t))
+        {
+            out.put(0);
+            offset++;
+        }
+
+        header.index_offset = offset;
+        out.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(uint64_t));
+        out.seekp(0);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        bool ok = bool(out);
+        out.close();
+        return ok;
+    }
+};
+
+class archive_reader
+{
+  private:
+
+    void *data = nullptr;
+    size_t length = 0;
+
+    archive_header header{};
+    const uint64_t *index = nullptr;
+
+    const uint8_t *base() const { return static_cast<const uint8_t *>(data); }
+
+  public:
+
+    archive_reader() = default;
+    archive_reader(archive_reader const&) = delete;
+    archive_reader& operator=(archive_reader const&) = delete;
+
+    ~archive_reader() { close(); }
+
+    bool open(std::string const& path)
+    {
+        close();
+
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd, &st) < 0 or (size_t)st.st_size < sizeof(archive_header))
+        {
+            ::close(fd);
+            return false;
+        }
+
+        void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED)
+            return false;
+
+        archive_header h;
+        std::memcpy(&h, p, sizeof(h));
+        uint64_t blocks = h.block_games ? (h.games + h.block_games - 1) / h.block_games : 0;
+        if (std::memcmp(h.magic, archive_magic, sizeof(archive_magic)) != 0 or
+            h.version != archive_version or h.block_games == 0 or
+            h.index_offset < sizeof(archive_header) or
+            h.index_offset % sizeof(uint64_t) != 0 or
+            h.index_offset + blocks * sizeof(uint64_t) > (uint64_t)st.st_size)
+        {
+            munmap(p, st.st_size);
+            return false;
+        }
+
+        // games are read front to back far more often than at random
+        madvise(p, st.st_size, MADV_SEQUENTIAL);
+
+        data = p;
+        length = st.st_size;
+        header = h;
+        index = reinterpret_cast<const uint64_t *>(base() + h.index_offset);
+        return true;
+    }
+
+    void close()
+    {
+        if (data)
+            munmap(data, length);
+        data = nullptr;
+        length = 0;
+        header = archive_header{};
+        index = nullptr;
+    }
+
+    size_t size() const { return header.games; }
+
+    // Reads the game at `offset` and moves `offset` past it. False if it
+    // runs past the games or holds a move off the board.
+    bool read_at(uint64_t & offset, archive_game & game) const
+    {
+        if (offset + sizeof(archive_game_header) > header.index_offset)
+            return false;
+
+        archive_game_header h;
+        std::memcpy(&h, base() + offset, sizeof(h));
+        uint64_t end = offset + sizeof(h) + h.moves;
+        if (end > header.index_offset)
+            return false;
+
+        const uint8_t *moves = base() + offset + sizeof(h);
+        if (std::any_of(moves, moves + h.moves, [](uint8_t m) { return m >= 15 * 15; }))
+            return false;
+
+        game.result = game_result(h.result);
+        game.rules = game_rules(h.rules);
+        game.black_rating = h.black_rating;
+        game.white_rating = h.white_rating;
+        game.moves = {moves, h.moves};
+        offset = end;
+        return true;
+    }
+
+    // Offset of the first game; pass it to read_at to stream all games.
+    uint64_t begin() const { return sizeof(archive_header); }
+
+    bool game(size_t i, archive_game & game) const
+    {
+        if (i >= size())
+            return false;
+
+        uint64_t offset = index[i / header.block_games];
+        for (size_t skip = i % header.block_games; skip > 0; skip--)
+        {
+            if (not read_at(offset, game))
+                return false;
+        }
+        return read_at(offset, game);
+    }
+};
+
+// Text formats. A move list holds one game per line: moves as a column
+// letter and a row number counted from the bottom ("h8 i9", spaces
+// optional), and optionally a result at the end, "1-0", "0-1" or "1/2-1/2".
+// A Piskvork file (.psq) holds one game: a "Piskvorky" header, then one
+// "column,row,time" line per move, counted from 1 at the top left.
+
+struct text_game
+{
+    std::vector<uint8_t> moves;
+    bool has_result = false;
+    game_result result = RESULT_DRAW;
+};
+
+// False if the line holds no moves or something that isn't a move.
+inline bool parse_move_list(std::string const& line, text_game & game)
+{
+    game = text_game{};
+
+    size_t i = 0;
+    while (i < line.size())
+    {
+        char c = std::tolower(line[i]);
+        if (std::isspace(c) or c == ',' or c == ';')
+        {
+            i++;
+            continue;
+        }
+
+        if (c == '1' or c == '0')
+        {
+            auto rest = line.substr(i);
+            if (rest.starts_with("1-0") or rest.starts_with("0-1") or rest.starts_with("1/2"))
+            {
+                game.has_result = true;
+                game.result = rest.starts_with("1-0") ? RESULT_BLACK : rest.starts_with("0-1") ? RESULT_WHITE : RESULT_DRAW;
+                break;
+            }
+        }
+
+        if (c < 'a' or c >= 'a' + 15)
+            return false;
+
+        int row = 0;
+        size_t j = i + 1;
+        while (j < line.size() and std::isdigit(line[j]) and row <= 15)
+            row = row * 10 + (line[j++] - '0');
+        if (j == i + 1 or row < 1 or row > 15)
+            return false;
+
+        game.moves.push_back(encode_move({15 - row, c - 'a'}));
+        i = j;
+    }
+    return not game.moves.empty();
+}
+
+inline bool parse_psq(std::istream & in, text_game & game)
+{
+    game = text_game{};
+
+    std::string line;
+    if (not std::getline(in, line) or not line.starts_with("Piskvorky"))
+        return false;
+
+    while (std::getline(in, line))
+    {
+        int col, row;
+        if (std::sscanf(line.c_str(), "%d,%d", &col, &row) != 2)
+            break;
+        if (gomoku_board::outbox(row - 1, col - 1))
+            return false;
+        game.moves.push_back(encode_move({row - 1, col - 1}));
+    }
+    return not game.moves.empty();
+}
+
+// The inverse of parse_move_list.
+inline std::string format_move_list(archive_game const& game)
+{
+    std::string s;
+    for (size_t i = 0; i < game.moves.size(); i++)
+    {
+        point_t p = game.move(i);
+        if (i)
+            s += ' ';
+        s += char('a' + p.y);
+        s += std::to_string(15 - p.x);
+    }
+    if (game.result == RESULT_BLACK)
+        s += " 1-0";
+    else if (game.result == RESULT_WHITE)
+        s += " 0-1";
+    else if (game.result == RESULT_DRAW)
+        s += " 1/2-1/2";
+    return s;
+}
+
+} // namespace nara
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <span>
+
+#include "board.hpp"
+#include "eval.hpp"
+#include "thread_pool.hpp"
+
+namespace nara
+{
+
+// Static evaluation of whole positions for callers outside the search, e.g.
+// scoring stored games in bulk. Every line of the padded board is scanned
+// once with a sliding window per colour, so each cell costs two table lookups
+// per direction instead of the 8-cell walks of get_state, and nothing is
+// allocated.
+
+// Empty cells where a move of one side makes the shape: five, an open four,
+// any other four, an open three, and two threats at once (two fours, a four
+// and an open three, or two open threes), the moves gen_chooses treats as
+// forcing.
+struct threat_summary
+{
+    int fives = 0;
+    int flex4 = 0;
+    int block4 = 0;
+    int flex3 = 0;
+    int doubles = 0;
+};
+
+struct position_eval
+{
+    // evaluate(board, BLACK) and evaluate(board, WHITE)
+    int black = 0;
+    int white = 0;
+
+    threat_summary black_threats;
+    threat_summary white_threats;
+};
+
+namespace detail
+{
+
+// A line window holds 9 cells, bit 8 four cells before the centre and bit 0
+// four cells after it; a pattern is the window without its centre.
+constexpr uint8_t window_pattern(unsigned window) { return ((window >> 5) & 0xf) << 4 | (window & 0xf); }
+
+constexpr unsigned centre = 1 << 4;
+
+// How many directions of a cell make each of FLEX3, BLOCK4, FLEX4 and FIVE.
+using threat_counts = std::array<uint8_t, 4>;
+
+inline void add_threat(threat_counts & counts, uint8_t category)
+{
+    if (category >= FLEX3)
+        counts[category - FLEX3]++;
+}
+
+inline void count_threats(threat_counts const& counts, threat_summary & t)
+{
+    auto [flex3, block4, flex4, five] = counts;
+    t.fives += five > 0;
+    t.flex4 += flex4 > 0;
+    t.block4 += block4 > 0;
+    t.flex3 += flex3 > 0;
+    t.doubles += block4 > 1 or (block4 and flex3) or flex3 > 1;
+}
+
+struct line_start
+{
+    int16_t index;
+    int8_t length;
+    int8_t dir;
+};
+
+// the first cell of every line of every direction, 15 + 15 + 29 + 29
+constexpr auto gen_line_starts()
+{
+    std::array<line_start, 88> starts{};
+    int n = 0;
+    for (int dir = 0; dir < 4; dir++)
+    {
+        point_t d = directions[dir];
+        for (int i = 0; i < 15; i++)
+        {
+            for (int j = 0; j < 15; j++)
+            {
+                point_t p{i, j};
+                if (not gomoku_board::outbox(p + d * -1))
+                    continue;
+                int length = 0;
+                for (point_t q = p; not gomoku_board::outbox(q); q = q + d)
+                    length++;
+                starts[n++] = {int16_t(gomoku_board::index(i, j)), int8_t(length), int8_t(dir)};
+            }
+        }
+    }
+    return starts;
+}
+
+inline constexpr std::array<line_start, 88> line_starts = gen_line_starts();
+
+} // namespace detail
+
+inline position_eval evaluate_position(gomoku_board const& board)
+{
+    using namespace detail;
+    position_eval res;
+
+    threat_counts threats[2][gomoku_board::PADDED * gomoku_board::PADDED] = {};
+
+    for (auto const& line : line_starts)
+    {
+        int step = gomoku_board::step_of[line.dir];
+
+        unsigned blk = 0, wht = 0, wall = 0;
+        auto push = [&](uint8_t c)
+        {
+            blk = blk << 1 | (c == BLACK);
+            wht = wht << 1 | (c == WHITE);
+            wall = wall << 1 | (c == gomoku_board::WALL);
+        };
+
+        for (int k = -4; k <= 4; k++)
+            push(board.cell(line.index + step * k));
+
+        for (int k = 0, at = line.index; k < line.length; k++, at += step)
+        {
+            // a colour without a stone in the window has no shape there,
+            // and nothing to score
+            if (blk)
+            {
+                auto const& info = pattern_of(window_pattern(blk), window_pattern(wht | wall));
+                add_threat(threats[0][at], info.category);
+                if (blk & centre)
+                    res.black += info.rank;
+            }
+            if (wht)
+            {
+                auto const& info = pattern_of(window_pattern(wht), window_pattern(blk | wall));
+                add_threat(threats[1][at], info.category);
+                if (wht & centre)
+                    res.white += info.rank;
+            }
+
+            // the window of the last cell already reaches the wall
+            if (k + 1 < line.length)
+                push(board.cell(at + step * 5));
+        }
+    }
+
+    for (int i = 0; i < 15; i++)
+    {
+        for (int j = 0; j < 15; j++)
+        {
+            int at = gomoku_board::index(i, j);
+            if (board.getchess(i, j) != EMPTY)
+                continue;
+            count_threats(threats[0][at], res.black_threats);
+            count_threats(threats[1][at], res.white_threats);
+        }
+    }
+    return res;
+}
+
+// The same from 15 * 15 cell values, cells[x * 15 + y], each EMPTY, BLACK or
+// WHITE.
+inline position_eval evaluate_position(const uint8_t *board)
+{
+    gomoku_board b;
+    for (int i = 0; i < 15 * 15; i++)
+        b.setchess(i / 15, i % 15, gomoku_chess(board[i]));
+    return evaluate_position(b);
+}
+
+// Evaluates every board into the same index of `out` on the workers of
+// `pool`, which take `chunk` boards at a time.
+inline void evaluate_batch(std::span<const gomoku_board> boards, std::span<position_eval> out, thread_pool & pool,
+                           size_t chunk = 256)
+{
+    assert(out.size() >= boards.size());
+
+    chunk = std::max<size_t>(chunk, 1);
+    pool.parallel_for((boards.size() + chunk - 1) / chunk, [&](int, size_t c)
+    {
+        size_t end = std::min(boards.size(), (c + 1) * chunk);
+        for (size_t i = c * chunk; i < end; i++)
+            out[i] = evaluate_position(boards[i]);
+    });
+}
+
+} // namespace nara
@@ -3,11 +3,26 @@
 #include <chrono>
 #include <string>
 #include <iostream>
+#include <utility>
+
+#include "perf.hpp"
 
 template <typename F>
 auto benchmark(F&& func) {
-    auto start = std::chrono::system_clock::now();
+    auto start = std::chrono::steady_clock::now();
     func();
-    auto end = std::chrono::system_clock::now();
+    auto end = std::chrono::steady_clock::now();
     return std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 }
+
+// Like benchmark, and also adds the hardware counters of the run to
+// `counters`; they stay zero unless built with NARA_PERF.
+template <typename F>
+auto benchmark(F&& func, nara::perf_sample & counters) {
+    auto begin = nara::read_perf_counters();
+    auto ms = benchmark(std::forward<F>(func));
+    auto end = nara::read_perf_counters();
+    for (int e = 0; e < nara::PERF_EVENTS; e++)
+        counters[e] += end[e] - begin[e];
+    return ms;
+}
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
 
 namespace nara
 {
@@ -10,32 +14,46 @@ struct point_t
 {
     int x;
     int y;
-    point_t(int _x = 0, int _y = 0) : x(_x), y(_y)
+    constexpr point_t(int _x = 0, int _y = 0) : x(_x), y(_y)
     {
     }
 };
 
-std::ostream &operator<<(std::ostream &os, point_t p)
+inline std::ostream &operator<<(std::ostream &os, point_t p)
 {
     return os << "[" << p.x << ", " << p.y << "]";
 }
 
-point_t operator *(point_t p, int fac)
+constexpr point_t operator *(point_t p, int fac)
 {
     return point_t(p.x * fac, p.y * fac);
 }
 
-point_t operator +(point_t p1, point_t p2)
+constexpr point_t operator +(point_t p1, point_t p2)
 {
     return point_t(p1.x + p2.x, p1.y + p2.y);
 }
 
-bool operator ==(point_t p1, point_t p2)
+constexpr bool operator ==(point_t p1, point_t p2)
 {
     return p1.x == p2.x and p1.y == p2.y;
 }
 
-const point_t directions[4] = {point_t{1, 0}, point_t{1, 1}, point_t{0, 1}, point_t{-1, 1}};
+// The 8 symmetries of the board: `sym & 3` quarter turns applied after an
+// optional mirror (`sym & 4`). Mirrors are their own inverse.
+constexpr point_t transform(point_t p, int sym)
+{
+    const int last = 14;
+    if (sym & 4)
+        p = point_t(p.x, last - p.y);
+    for (int r = 0; r < (sym & 3); r++)
+        p = point_t(p.y, last - p.x);
+    return p;
+}
+
+constexpr int inverse_sym(int sym) { return (sym & 4) ? sym : (4 - sym) & 3; }
+
+constexpr point_t directions[4] = {point_t{1, 0}, point_t{1, 1}, point_t{0, 1}, point_t{-1, 1}};
 
 enum gomoku_chess
 {
@@ -44,47 +62,69 @@ enum gomoku_chess
     WHITE
 };
 
-gomoku_chess oppof(gomoku_chess chess)
+inline gomoku_chess oppof(gomoku_chess chess)
 {
     assert(not chess == EMPTY);
     return chess == BLACK ? WHITE : BLACK;
 }
 
+// The board is kept inside a border of `PAD` wall cells, as one array in
+// which a step along directions[dir] is a fixed offset, step_of[dir]. A walk
+// of up to PAD cells from any cell of the board reads walls past the edge
+// instead of checking bounds.
 class gomoku_board
 {
   public:
     static const int WIDTH = 15;
+    static constexpr int PAD = 4;
+    static constexpr int PADDED = WIDTH + 2 * PAD;
+
+    // the value of cells outside the board
+    static constexpr uint8_t WALL = 3;
+
+    static constexpr int step_of[4] = {
+        directions[0].x * PADDED + directions[0].y, directions[1].x * PADDED + directions[1].y,
+        directions[2].x * PADDED + directions[2].y, directions[3].x * PADDED + directions[3].y};
 
-    gomoku_chess chesses[WIDTH][WIDTH];
+  private:
+
+    uint8_t cells[PADDED * PADDED];
+
+  public:
 
     gomoku_board()
     {
+        std::fill(std::begin(cells), std::end(cells), WALL);
         for (int i = 0; i < WIDTH; i++)
             for (int j = 0; j < WIDTH; j++)
-                chesses[i][j] = EMPTY;
+                cells[index(i, j)] = EMPTY;
     }
 
-    gomoku_board(gomoku_board const &board)
-    {
-        for (int i = 0; i < WIDTH; i++)
-            for (int j = 0; j < WIDTH; j++)
-                chesses[i][j] = board.chesses[i][j];
-    }
+    // boards are copied and assigned whole, walls included
+    gomoku_board(gomoku_board const&) = default;
+    gomoku_board& operator=(gomoku_board const&) = default;
 
     static constexpr inline bool outbox(int x, int y)
     {
         return x < 0 or x >= WIDTH or y < 0 or y >= WIDTH;
     }
 
-    static inline bool outbox(point_t pos)
+    static constexpr inline bool outbox(point_t pos)
     {
         return outbox(pos.x, pos.y);
     }
 
+    static constexpr int index(int x, int y) { return (x + PAD) * PADDED + y + PAD; }
+
+    static constexpr int index(point_t pos) { return index(pos.x, pos.y); }
+
+    // The cell at a padded index, EMPTY, BLACK, WHITE or WALL.
+    uint8_t cell(int idx) const { return cells[idx]; }
+
     gomoku_chess getchess(int x, int y) const
     {
         assert(not outbox(x, y));
-        return chesses[x][y];
+        return gomoku_chess(cells[index(x, y)]);
     }
 
     gomoku_chess getchess(point_t pos) const
@@ -95,7 +135,7 @@ class gomoku_board
     void setchess(int x, int y, gomoku_chess chess)
     {
         assert(not outbox(x, y));
-        chesses[x][y] = chess;
+        cells[index(x, y)] = chess;
     }
 
     void setchess(point_t pos, gomoku_chess chess)
@@ -104,4 +144,31 @@ class gomoku_board
     }
 };
 
+// How many cells, up to 4, the line through a cell runs on in each direction
+// before the edge: line_reach[x][y][dir] = {backward, forward}.
+constexpr auto gen_line_reach()
+{
+    std::array<std::array<std::array<std::array<int8_t, 2>, 4>, 15>, 15> reach{};
+    for (int x = 0; x < 15; x++)
+    {
+        for (int y = 0; y < 15; y++)
+        {
+            for (int dir = 0; dir < 4; dir++)
+            {
+                for (int side = 0; side < 2; side++)
+                {
+                    int n = 0;
+                    point_t d = directions[dir] * (side ? 1 : -1);
+                    while (n < 4 and not gomoku_board::outbox(point_t{x, y} + d * (n + 1)))
+                        n++;
+                    reach[x][y][dir][side] = n;
+                }
+            }
+        }
+    }
+    return reach;
+}
+
+inline constexpr auto line_reach = gen_line_reach();
+
 } // namespace nara
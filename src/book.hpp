@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "board.hpp"
+#include "zobrist.hpp"
+
+namespace nara
+{
+
+// On-disk layout: a book_header followed by `count` book_entry records
+// sorted by key, entries of one key sorted by descending weight. Keys are
+// canonical (symmetry-normalized) zobrist keys and moves are stored in the
+// canonical orientation.
+
+struct book_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint64_t seed;
+};
+
+struct book_entry
+{
+    uint64_t key;
+    uint8_t x;
+    uint8_t y;
+    uint16_t weight;
+    int32_t score;
+};
+
+static_assert(sizeof(book_header) == 24);
+static_assert(sizeof(book_entry) == 16);
+
+const char book_magic[8] = {'N', 'A', 'R', 'A', 'B', 'O', 'O', 'K'};
+const uint32_t book_version = 1;
+
+class opening_book
+{
+  private:
+
+    void *data = nullptr;
+    size_t length = 0;
+
+    const book_entry *entries = nullptr;
+    size_t count = 0;
+
+  public:
+
+    opening_book() = default;
+    opening_book(opening_book const&) = delete;
+    opening_book& operator=(opening_book const&) = delete;
+
+    ~opening_book() { close(); }
+
+    bool open(std::string const& path)
+    {
+        close();
+
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd, &st) < 0 or (size_t)st.st_size < sizeof(book_header))
+        {
+            ::close(fd);
+            return false;
+        }
+
+        void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED)
+            return false;
+
+        auto header = static_cast<const book_header *>(p);
+        if (std::memcmp(header->magic, book_magic, sizeof(book_magic)) != 0 or
+            header->version != book_version or
+            header->seed != zobrist_seed or
+            sizeof(book_header) + header->count * sizeof(book_entry) > (size_t)st.st_size)
+        {
+            munmap(p, st.st_size);
+            return false;
+        }
+
+        data = p;
+        length = st.st_size;
+        entries = reinterpret_cast<const book_entry *>(header + 1);
+        count = header->count;
+        return true;
+    }
+
+    void close()
+    {
+        if (data)
+            munmap(data, length);
+        data = nullptr;
+        length = 0;
+        entries = nullptr;
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+
+    // All entries stored for `key`, best first.
+    std::pair<const book_entry *, const book_entry *> probe(uint64_t key) const
+    {
+        auto less = [](book_entry const& e, uint64_t k) { return e.key < k; };
+        auto first = std::lower_bound(entries, entries + count, key, less);
+        auto last = first;
+        while (last != entries + count and last->key == key)
+            last++;
+        return {first, last};
+    }
+
+    // Book move for `board` mapped back to the board's own orientation.
+    bool lookup(gomoku_board const& board, point_t & move, int & score) const
+    {
+        if (count == 0)
+            return false;
+
+        auto [key, sym] = canonical_key(board);
+        auto [first, last] = probe(key);
+
+        for (auto e = first; e != last; e++)
+        {
+            point_t p = transform({e->x, e->y}, inverse_sym(sym));
+            if (gomoku_board::outbox(p) or board.getchess(p) != EMPTY)
+                continue;
+            move = p;
+            score = e->score;
+            return true;
+        }
+        return false;
+    }
+};
+
+inline bool write_book(std::string const& path, std::vector<book_entry> entries)
+{
+    std::ranges::sort(entries, [](book_entry const& e1, book_entry const& e2)
+    {
+        return e1.key != e2.key ? e1.key < e2.key : e1.weight > e2.weight;
+    });
+
+    book_header header;
+    std::memcpy(header.magic, book_magic, sizeof(book_magic));
+    header.version = book_version;
+    header.count = entries.size();
+    header.seed = zobrist_seed;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (not out)
+        return false;
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(book_entry));
+    return bool(out);
+}
+
+} // namespace nara
@@ -0,0 +1,113 @@
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "ai.hpp"
+#include "book.hpp"
+#include "board.hpp"
+#include "eval.hpp"
+#include "log.hpp"
+#include "zobrist.hpp"
+
+// Builds an opening book from self-play. Each game starts from a few random
+// stones around the center, then two engines searching at `depth` play the
+// next `plies` moves. Every engine move is recorded under the canonical key
+// of the position it was played in; moves chosen more often get more weight.
+
+struct book_stat
+{
+    int weight = 0;
+    long score_sum = 0;
+};
+
+nara::point_t random_opening_move(nara::gomoku_board const& board, std::mt19937 & gen)
+{
+    std::vector<nara::point_t> near;
+    for (int i = 5; i <= 9; i++)
+        for (int j = 5; j <= 9; j++)
+            if (board.getchess(i, j) == nara::EMPTY)
+                near.push_back({i, j});
+    return near[std::uniform_int_distribution<size_t>(0, near.size() - 1)(gen)];
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <output> [games] [plies] [depth]" << std::endl;
+        return 1;
+    }
+
+    std::string output = argv[1];
+    int games = (argc > 2) ? std::atoi(argv[2]) : 16;
+    int plies = (argc > 3) ? std::atoi(argv[3]) : 10;
+    int depth = (argc > 4) ? std::atoi(argv[4]) : 6;
+
+    logger.open("LOG");
+
+    nara::gomoku_ai ai_blk(nara::BLACK);
+    nara::gomoku_ai ai_wht(nara::WHITE);
+    ai_blk.set_log(&logger);
+    ai_wht.set_log(&logger);
+
+    std::map<std::tuple<uint64_t, int, int>, book_stat> stats;
+    std::mt19937 gen(0);
+
+    for (int g = 0; g < games; g++)
+    {
+        nara::gomoku_board board;
+        nara::gomoku_chess turn = nara::BLACK;
+
+        int random_moves = g % 3;
+        for (int i = 0; i < random_moves; i++)
+        {
+            board.setchess(random_opening_move(board, gen), turn);
+            turn = nara::oppof(turn);
+        }
+
+        for (int ply = random_moves; ply < plies; ply++)
+        {
+            auto & ai = (turn == nara::BLACK) ? ai_blk : ai_wht;
+            auto res = ai.search(board, depth);
+
+            auto [key, sym] = nara::canonical_key(board);
+            auto p = nara::transform(res.p, sym);
+            auto & stat = stats[{key, p.x, p.y}];
+            stat.weight++;
+            stat.score_sum += res.score;
+
+            board.setchess(res.p, turn);
+            if (nara::get_winner(board, res.p) != nara::EMPTY)
+                break;
+            turn = nara::oppof(turn);
+        }
+
+        std::cout << "game " << g + 1 << "/" << games << ", " << stats.size() << " entries" << std::endl;
+    }
+
+    std::vector<nara::book_entry> entries;
+    for (auto & [k, stat] : stats)
+    {
+        nara::book_entry e;
+        e.key = std::get<0>(k);
+        e.x = std::get<1>(k);
+        e.y = std::get<2>(k);
+        e.weight = std::min(stat.weight, 0xffff);
+        e.score = stat.score_sum / stat.weight;
+        entries.push_back(e);
+    }
+
+    if (not nara::write_book(output, entries))
+    {
+        std::cerr << "failed to write " << output << std::endl;
+        return 1;
+    }
+
+    std::cout << "wrote " << entries.size() << " entries to " << output << std::endl;
+    logger.close();
+    return 0;
+}
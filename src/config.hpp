@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+#include "board.hpp"
+
+namespace nara
+{
+
+enum search_backend
+{
+    ALPHABETA,
+    MCTS,
+};
+
+// Selective search features of gomoku_ai, all off by default.
+struct search_config
+{
+    // Let the side to move pass and search the reply `null_reduction` plies
+    // shallower; if that still fails high the node is cut. Only tried when
+    // the opponent has no four or open three to punish the pass with.
+    bool null_move = false;
+    int null_reduction = 2;
+
+    // Search quiet moves ranked late by `rankof` `lmr_reduction` plies
+    // shallower with a null window, re-searching at full depth if they beat
+    // the window. An even reduction keeps the leaves on the same side, which
+    // matters since the static eval favours whoever moved last.
+    bool late_move_reduction = false;
+    int lmr_reduction = 2;
+    int lmr_min_depth = 4;
+    int lmr_min_index = 4;
+
+    // Near the leaves, skip quiet moves when the static eval is too far below
+    // the window for one move to catch up. Indexed by remaining depth.
+    bool futility = false;
+    std::array<int, 3> futility_margin = {0, 60, 180};
+
+    // At the horizon keep searching fives, fours and blocks of fives until
+    // the position is quiet, at most `qs_max_depth` plies deep and
+    // `qs_node_limit` nodes below each horizon node. Quiescence nodes count
+    // towards the node limit like any other.
+    bool quiescence = false;
+    int qs_max_depth = 8;
+    long qs_node_limit = 2000;
+
+    // Search forcing moves a ply deeper: every reply to a four, and moves
+    // that make a four or a double three. With `singular_extension`, also
+    // the TT move when a search of half the depth finds every other move
+    // `singular_margin` worse, from `singular_min_depth` on. A line gets at
+    // most `max_extensions` extra plies.
+    bool extensions = false;
+    bool singular_extension = false;
+    int singular_min_depth = 5;
+    int singular_margin = 50;
+    int max_extensions = 4;
+
+    // Search with Monte Carlo tree search instead of alpha-beta: PUCT over
+    // gen_chooses' moves with priors from their pattern ranks (a softmax at
+    // `mcts_prior_temperature`), the static eval squashed by tanh at
+    // `mcts_value_scale` at the leaves, and `mcts_threads` threads sharing
+    // one tree through virtual loss. A search runs `max_nodes` playouts of
+    // its limits, or `mcts_playouts` without one; the tree holds at most
+    // `mcts_tree_nodes` nodes.
+    search_backend backend = ALPHABETA;
+    int mcts_threads = 1;
+    long mcts_playouts = 20000;
+    float mcts_cpuct = 1.5f;
+    int mcts_virtual_loss = 3;
+    float mcts_prior_temperature = 10;
+    float mcts_value_scale = 200;
+    size_t mcts_tree_nodes = 1 << 20;
+};
+
+// What an iterative deepening search has found so far: the result of the
+// deepest completed iteration and the nodes searched until now.
+struct search_progress
+{
+    int depth;
+    long nodes;
+    long ms;
+    int score;
+    point_t best;
+};
+
+// Limits of an iterative deepening search. The node limit, the hard time
+// limit and `cancel` are checked from the second iteration on, so a depth 1
+// move is always available. `on_progress` is called on the searching thread
+// after every iteration and every `progress_interval` nodes; an interval of
+// 0 leaves only the calls after iterations.
+struct search_limits
+{
+    int max_depth = 6;
+    long max_nodes = 0;
+
+    // Time budget of the move, 0 for none, see time_manager. The hard limit
+    // defaults to three times the budget. Without `adaptive_time` no
+    // iteration starts that is expected to end past the budget, but the
+    // budget isn't scaled.
+    long move_time_ms = 0;
+    long max_time_ms = 0;
+    bool adaptive_time = true;
+
+    const std::atomic<bool> *cancel = nullptr;
+    std::function<void(search_progress const&)> on_progress;
+    long progress_interval = 4096;
+};
+
+} // namespace nara
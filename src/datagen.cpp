@@ -0,0 +1,131 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ai.hpp"
+#include "board.hpp"
+#include "config.hpp"
+#include "dataset.hpp"
+#include "eval.hpp"
+
+// Generates training positions from self-play. Every thread plays its own
+// games with two engines searching a fixed number of nodes, starting from a
+// few random stones near the center, and appends each finished game to the
+// output in one write.
+//
+//     nara_datagen <output> [games] [nodes] [threads]
+
+void play_games(int id, int games, long nodes, std::atomic<int> & next_game,
+                std::atomic<long> & positions, nara::dataset_writer & writer, std::mutex & writer_mutex)
+{
+    nara::gomoku_ai ai_blk(nara::BLACK);
+    nara::gomoku_ai ai_wht(nara::WHITE);
+    std::mt19937 gen(id);
+
+    nara::search_limits limits;
+    limits.max_depth = 20;
+    limits.max_nodes = nodes;
+
+    std::vector<nara::dataset_record> game;
+    std::vector<uint8_t> encoded;
+
+    while (next_game++ < games)
+    {
+        ai_blk.clear_table();
+        ai_wht.clear_table();
+
+        nara::gomoku_board board;
+        nara::gomoku_chess turn = nara::BLACK;
+        std::uniform_int_distribution<int> near(4, 10);
+
+        // occupied cells are drawn again, so the ply labels count the
+        // stones on the board
+        int random_moves = 1 + gen() % 4;
+        for (int placed = 0; placed < random_moves;)
+        {
+            nara::point_t p{near(gen), near(gen)};
+            if (board.getchess(p) != nara::EMPTY)
+                continue;
+            board.setchess(p, turn);
+            turn = nara::oppof(turn);
+            placed++;
+        }
+
+        game.clear();
+        nara::gomoku_chess winner = nara::EMPTY;
+        for (int ply = random_moves; ply < 15 * 15 and winner == nara::EMPTY; ply++)
+        {
+            auto & ai = (turn == nara::BLACK) ? ai_blk : ai_wht;
+            auto res = ai.search(board, limits);
+
+            game.push_back(nara::dataset_record{board, turn, res.p, res.score, ply, nara::RESULT_DRAW});
+
+            board.setchess(res.p, turn);
+            winner = nara::get_winner(board, res.p);
+            turn = nara::oppof(turn);
+        }
+
+        auto result = (winner == nara::BLACK) ? nara::RESULT_BLACK
+                    : (winner == nara::WHITE) ? nara::RESULT_WHITE
+                    : nara::RESULT_DRAW;
+
+        encoded.clear();
+        for (auto & r : game)
+        {
+            r.result = result;
+            nara::encode_record(encoded, r);
+        }
+
+        {
+            std::lock_guard lock(writer_mutex);
+            writer.append(encoded);
+        }
+        positions += game.size();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <output> [games] [nodes] [threads]" << std::endl;
+        return 1;
+    }
+
+    std::string output = argv[1];
+    int games = (argc > 2) ? std::atoi(argv[2]) : 100;
+    long nodes = (argc > 3) ? std::atol(argv[3]) : 2000;
+    int threads = (argc > 4) ? std::atoi(argv[4]) : std::max(1u, std::thread::hardware_concurrency());
+
+    nara::dataset_writer writer;
+    if (not writer.open(output))
+    {
+        std::cerr << "can't open " << output << std::endl;
+        return 1;
+    }
+
+    std::atomic<int> next_game = 0;
+    std::atomic<long> positions = 0;
+    std::mutex writer_mutex;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+        workers.emplace_back(play_games, t, games, nodes, std::ref(next_game),
+                             std::ref(positions), std::ref(writer), std::ref(writer_mutex));
+    for (auto & w : workers)
+        w.join();
+    writer.flush();
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << positions << " positions in " << secs << " s, "
+              << positions / secs / threads << " positions/s per thread" << std::endl;
+    return 0;
+}
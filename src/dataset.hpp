@@ -0,0 +1,208 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "board.hpp"
+
+namespace nara
+{
+
+// Training positions in an append-only stream: an 8-byte magic, a version,
+// then records back to back with no index, so files can be concatenated and
+// read while they are still being written. A record is
+//
+//     flags       1 byte: side to move (bit 0), result (bits 1-2)
+//     move        1 byte: best move, x * 15 + y
+//     score       zigzag varint, search score for the side to move
+//     ply         varint
+//     occupied    29 bytes: bit x * 15 + y set for every stone
+//     colours     one bit per stone in occupied order, set for white
+//
+// which is about 35 bytes for a middle game position.
+
+enum game_result : uint8_t
+{
+    RESULT_DRAW,
+    RESULT_BLACK,
+    RESULT_WHITE,
+};
+
+struct dataset_record
+{
+    gomoku_board board;
+    gomoku_chess next;
+    point_t move;
+    int score;
+    int ply;
+    game_result result;
+};
+
+const char dataset_magic[8] = {'N', 'A', 'R', 'A', 'D', 'A', 'T', 'A'};
+const uint8_t dataset_version = 1;
+
+namespace detail
+{
+
+inline void put_varint(std::vector<uint8_t> & out, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back(uint8_t(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(uint8_t(v));
+}
+
+inline uint64_t zigzag(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+
+inline int64_t unzigzag(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+} // namespace detail
+
+// Encodes records into a caller-owned buffer, so a generator thread can
+// batch a whole game and append it in one write.
+inline void encode_record(std::vector<uint8_t> & out, dataset_record const& r)
+{
+    out.push_back((r.next == WHITE ? 1 : 0) | (r.result << 1));
+    out.push_back(r.move.x * 15 + r.move.y);
+    detail::put_varint(out, detail::zigzag(r.score));
+    detail::put_varint(out, r.ply);
+
+    std::array<uint8_t, 29> occupied{};
+    std::vector<uint8_t> colours;
+    int stones = 0;
+    for (int i = 0; i < 15 * 15; i++)
+    {
+        auto chess = r.board.getchess(i / 15, i % 15);
+        if (chess == EMPTY)
+            continue;
+        occupied[i / 8] |= 1 << (i % 8);
+        if (stones % 8 == 0)
+            colours.push_back(0);
+        if (chess == WHITE)
+            colours.back() |= 1 << (stones % 8);
+        stones++;
+    }
+    out.insert(out.end(), occupied.begin(), occupied.end());
+    out.insert(out.end(), colours.begin(), colours.end());
+}
+
+class dataset_writer
+{
+  private:
+
+    std::ofstream out;
+
+  public:
+
+    bool open(std::string const& path)
+    {
+        out.open(path, std::ios::binary | std::ios::app);
+        if (not out)
+            return false;
+        if (out.tellp() == 0)
+        {
+            out.write(dataset_magic, sizeof(dataset_magic));
+            out.put(dataset_version);
+        }
+        return bool(out);
+    }
+
+    void append(std::vector<uint8_t> const& encoded)
+    {
+        out.write(reinterpret_cast<const char *>(encoded.data()), encoded.size());
+    }
+
+    void flush() { out.flush(); }
+};
+
+class dataset_reader
+{
+  private:
+
+    std::ifstream in;
+
+    bool get_varint(uint64_t & v)
+    {
+        v = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            int c = in.get();
+            if (c == EOF)
+                return false;
+            v |= uint64_t(c & 0x7f) << shift;
+            if ((c & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+
+  public:
+
+    bool open(std::string const& path)
+    {
+        in.open(path, std::ios::binary);
+        char magic[8];
+        in.read(magic, sizeof(magic));
+        int version = in.get();
+        return in and std::memcmp(magic, dataset_magic, sizeof(magic)) == 0 and version == dataset_version;
+    }
+
+    // False at the end of the stream or on a truncated or damaged record:
+    // a move off the board, an unknown result or flag, or a stone past the
+    // last cell.
+    bool next(dataset_record & r)
+    {
+        int flags = in.get();
+        int move = in.get();
+        if (flags == EOF or move == EOF)
+            return false;
+        if (move >= 15 * 15 or (flags >> 1) > RESULT_WHITE)
+            return false;
+
+        uint64_t score, ply;
+        if (not get_varint(score) or not get_varint(ply))
+            return false;
+
+        std::array<uint8_t, 29> occupied;
+        in.read(reinterpret_cast<char *>(occupied.data()), occupied.size());
+        if (not in or (occupied.back() >> (15 * 15 % 8)) != 0)
+            return false;
+
+        int stones = 0;
+        for (uint8_t b : occupied)
+            stones += std::popcount(b);
+
+        std::vector<uint8_t> colours((stones + 7) / 8);
+        in.read(reinterpret_cast<char *>(colours.data()), colours.size());
+        if (not in)
+            return false;
+
+        r.next = (flags & 1) ? WHITE : BLACK;
+        r.result = game_result((flags >> 1) & 3);
+        r.move = {move / 15, move % 15};
+        r.score = detail::unzigzag(score);
+        r.ply = ply;
+
+        int k = 0;
+        for (int i = 0; i < 15 * 15; i++)
+        {
+            gomoku_chess chess = EMPTY;
+            if (occupied[i / 8] & (1 << (i % 8)))
+            {
+                chess = (colours[k / 8] & (1 << (k % 8))) ? WHITE : BLACK;
+                k++;
+            }
+            r.board.setchess(i / 15, i % 15, chess);
+        }
+        return true;
+    }
+};
+
+} // namespace nara
@@ -1,12 +1,13 @@
 #pragma once
 
 #include <array>
+#include <bit>
 #include <cstdint>
 #include <cmath>
 #include <numeric>
 
-#include "log.hpp"
 #include "board.hpp"
+#include "eval_weights.hpp"
 
 namespace nara
 {
@@ -88,49 +89,111 @@ constexpr int cal_category(uint8_t px, uint8_t py)
     return NONE;
 }
 
-int bit_count(uint8_t x)
-{
-    int cnt = 0;
-    while (x)
-    {
-        cnt += x & 1;
-        x >>= 1;
-    }
-    return cnt;
-}
+constexpr int bit_count(uint8_t x) { return std::popcount(x); }
 
 using line_pattern = std::array<uint8_t, 2>;
 
-int cal_rank(uint8_t px, uint8_t py)
+const uint8_t rank_masks[5] = {0b11110000, 0b01111000, 0b00111100, 0b00011110, 0b00001111};
+
+constexpr int cal_rank(uint8_t px, uint8_t py, eval_weights const& weights = default_eval_weights)
 {
-    static const int rank[5] = {1, 4, 9, 16, 25};
-    static const uint8_t masks[5] = {0b11110000, 0b01111000, 0b00111100, 0b00011110, 0b00001111};
     int val = 0;
-    for (uint8_t mask : masks)
+    for (uint8_t mask : rank_masks)
         if ((mask & py) == 0)
-            val += rank[bit_count(mask & px)];
+            val += weights.rank[bit_count(mask & px)];
     return val;
 }
 
-int cal_rank(line_pattern p) { return cal_rank(p[0], p[1]); }
+// How many open windows of each rank the pattern has; cal_rank is the dot
+// product of these counts with eval_weights::rank.
+inline void add_rank_counts(uint8_t px, uint8_t py, std::array<int, 5> & counts)
+{
+    for (uint8_t mask : rank_masks)
+        if ((mask & py) == 0)
+            counts[bit_count(mask & px)]++;
+}
+
+// A pattern read as 8 base-3 digits, one per cell: 0 empty, 1 own stone, 2
+// blocked by the opponent or the edge. The table is written from the point
+// of view of the side owning the pattern, so each colour's pattern is looked
+// up on its own; an index covering both would need a fourth digit value for
+// the edge, as an edge blocks both sides, and 4^8 entries.
+constexpr int pattern_count = 6561;
 
-constexpr auto gen_category_table()
+constexpr auto gen_ternary_digits()
 {
-    std::array<std::array<int, 256>, 256> table{};
+    std::array<uint16_t, 256> digits{};
+    for (int b = 0; b < 256; b++)
+    {
+        for (int i = 7; i >= 0; i--)
+            digits[b] = digits[b] * 3 + ((b >> i) & 1);
+    }
+    return digits;
+}
+
+// the bits of a byte as base-3 digits
+inline constexpr std::array<uint16_t, 256> ternary_digits = gen_ternary_digits();
+
+constexpr int pattern_index(uint8_t px, uint8_t py) { return ternary_digits[px] + 2 * ternary_digits[py]; }
+
+// Everything read from one line pattern, in one 4-byte entry so that the
+// whole table (26 KB) stays in L1. `defense` has bit i set when a stone of
+// the other colour on cell i lowers the category, so these are the only
+// cells of the line that can answer the threat it makes.
+struct pattern_info
+{
+    uint8_t category;
+    uint8_t defense;
+    int16_t rank;
+};
+
+constexpr auto gen_pattern_table()
+{
+    std::array<pattern_info, pattern_count> table{};
 
     for (int px = 0; px < 256; px++)
+    {
         for (int py = 0; py < 256; py++)
-            table[px][py] = cal_category(px, py);
+        {
+            if (px & py)
+                continue;
+            auto & e = table[pattern_index(px, py)];
+            e.category = cal_category(px, py);
+            e.rank = cal_rank(px, py);
+        }
+    }
 
+    for (int px = 0; px < 256; px++)
+    {
+        for (int py = 0; py < 256; py++)
+        {
+            if (px & py)
+                continue;
+            auto & e = table[pattern_index(px, py)];
+            for (int i = 0; i < 8; i++)
+            {
+                if (is_empty(px, py, i) and table[pattern_index(px, py | (1 << i))].category < e.category)
+                    e.defense |= 1 << i;
+            }
+        }
+    }
     return table;
 }
 
-constexpr std::array<std::array<int, 256>, 256> category_table = gen_category_table();
+inline constexpr std::array<pattern_info, pattern_count> pattern_table = gen_pattern_table();
+
+constexpr pattern_info const& pattern_of(uint8_t px, uint8_t py) { return pattern_table[pattern_index(px, py)]; }
 
-constexpr int get_category(uint8_t px, uint8_t py) { return category_table[px][py]; }
+constexpr pattern_info const& pattern_of(line_pattern p) { return pattern_of(p[0], p[1]); }
+
+constexpr int get_category(uint8_t px, uint8_t py) { return pattern_of(px, py).category; }
 
 constexpr int get_category(line_pattern p) { return get_category(p[0], p[1]); }
 
+// Cell `bit` of a pattern lies `pattern_offset(bit)` steps from its center
+// along the line, see get_state.
+constexpr int pattern_offset(int bit) { return (bit >= 4) ? 3 - bit : 4 - bit; }
+
 struct chess_state
 {
     line_pattern pattern_blk[4];
@@ -143,7 +206,9 @@ struct chess_state
 
     int neighbors[4];
 
+    // rank of each colour, and the share of it each direction adds
     int rank[2];
+    int dir_rank[2][4];
 
     line_pattern get_pattern(gomoku_chess chess, int dir)
     {
@@ -160,16 +225,6 @@ struct chess_state
 
     int rankof(gomoku_chess chess) { return (chess == BLACK) ? rank[0] : rank[1]; }
 
-    void update_rank()
-    {
-        rank[0] = rank[1] = 0;
-        for (int dir = 0; dir < 4; dir++)
-        {
-            rank[0] += cal_rank(pattern_blk[dir]);
-            rank[1] += cal_rank(pattern_wht[dir]);
-        }
-    }
-
     void update_chess(gomoku_chess chess, int dir, int step)
     {
         assert(step != 0);
@@ -203,8 +258,7 @@ struct chess_state
                 neighbors[dir]++;
         }
 
-        update_cats(dir);
-        update_rank();
+        update_dir(dir);
     }
 
     bool has_neighbor()
@@ -214,32 +268,41 @@ struct chess_state
 
     bool has_category(gomoku_chess for_chess, int cat)
     {
+        const auto & cats = (for_chess == BLACK) ? cats_blk : cats_wht;
         for (int dir = 0; dir < 4; dir++)
         {
-            auto p = get_pattern(for_chess, dir);
-            if (cal_category(p[0], p[1]) == cat)
+            if (cats[dir][cat])
                 return true;
         }
         return false;
     }
 
-    void update_cats(int dir)
+    // Reads the table entries of both colours' patterns along `dir` once,
+    // for the direction's categories and its share of the ranks; the other
+    // directions are unchanged by a stone on this line.
+    void update_dir(int dir)
     {
-        cats_blk[dir] = cats_wht[dir] = {0};
+        auto const& blk = pattern_of(pattern_blk[dir]);
+        auto const& wht = pattern_of(pattern_wht[dir]);
 
-        line_pattern p;
-
-        p = get_pattern(BLACK, dir);
-        cats_blk[dir][get_category(p)]++;
+        cats_blk[dir] = cats_wht[dir] = {0};
+        cats_blk[dir][blk.category]++;
+        cats_wht[dir][wht.category]++;
 
-        p = get_pattern(WHITE, dir);
-        cats_wht[dir][get_category(p)]++;
+        rank[0] += blk.rank - dir_rank[0][dir];
+        rank[1] += wht.rank - dir_rank[1][dir];
+        dir_rank[0][dir] = blk.rank;
+        dir_rank[1][dir] = wht.rank;
     }
 
-    void update_cats()
+    void update_dirs()
     {
+        rank[0] = rank[1] = 0;
         for (int dir = 0; dir < 4; dir++)
-            update_cats(dir);
+        {
+            dir_rank[0][dir] = dir_rank[1][dir] = 0;
+            update_dir(dir);
+        }
     }
 
     static std::array<int, 10> sum_cats(std::array<int, 10> prev, const std::array<int, 10> & one)
@@ -262,81 +325,54 @@ struct chess_state
     }
 };
 
-// bool state_equal(chess_state s1, chess_state s2)
-// {
-//     for (int i = 0; i < 4; i++)
-//     {
-//         if (s1.neighbors[i] != s2.neighbors[i] or
-//             s1.pattern_blk[i].px != s2.pattern_blk[i].px or
-//             s1.pattern_blk[i].py != s2.pattern_blk[i].py or
-//             s1.pattern_wht[i].px != s2.pattern_wht[i].px or
-//             s1.pattern_wht[i].py != s2.pattern_wht[i].py)
-//             return false;
-//     }
-//     return true;
-// }
-
-chess_state get_state(gomoku_board const& board, point_t pos)
+// Whether two states agree on everything the search reads, e.g. an
+// incrementally updated state and one recomputed by get_state.
+inline bool state_equal(chess_state const& s1, chess_state const& s2)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        if (s1.neighbors[i] != s2.neighbors[i] or
+            s1.pattern_blk[i] != s2.pattern_blk[i] or
+            s1.pattern_wht[i] != s2.pattern_wht[i] or
+            s1.cats_blk[i] != s2.cats_blk[i] or
+            s1.cats_wht[i] != s2.cats_wht[i])
+            return false;
+    }
+    return s1.rank[0] == s2.rank[0] and s1.rank[1] == s2.rank[1];
+}
+
+inline chess_state get_state(gomoku_board const& board, point_t pos)
 {
     chess_state ret;
+    int at = gomoku_board::index(pos);
     for (int dir = 0; dir < 4; dir++)
     {
-        int neigh_cnt = 0;
-        uint8_t blk_px, blk_py, wht_px, wht_py;
-        blk_px = blk_py = wht_px = wht_py = 0;
+        int step = gomoku_board::step_of[dir];
+        unsigned blk = 0, wht = 0, wall = 0, neigh_cnt = 0;
         int i = 7;
         for (int fac = -4; fac <= 4; fac++)
         {
             if (fac == 0) continue;
 
-            point_t p = pos + directions[dir] * fac;
-
-            if (board.outbox(p))
-            {
-                blk_py |= (1 << i);
-                wht_py |= (1 << i);
-            }
-            else if (board.getchess(p) == BLACK)
-            {
-                blk_px |= (1 << i);
-                wht_py |= (1 << i);
-            }
-            else if (board.getchess(p) == WHITE)
-            {
-                blk_py |= (1 << i);
-                wht_px |= (1 << i);
-            }
+            uint8_t c = board.cell(at + step * fac);
+            blk |= unsigned(c == BLACK) << i;
+            wht |= unsigned(c == WHITE) << i;
+            wall |= unsigned(c == gomoku_board::WALL) << i;
+            if (fac >= -2 and fac <= 2)
+                neigh_cnt += (c == BLACK) + (c == WHITE);
             i--;
         }
-        ret.set_pattern(BLACK, dir, blk_px, blk_py);
-        ret.set_pattern(WHITE, dir, wht_px, wht_py);
-    }
-    ret.update_cats();
-    ret.update_rank();
-
-    for (int dir = 0; dir < 4; dir++)
-    {
-        int neigh_cnt = 0;
-        for (int fac = -2; fac <= 2; fac++)
-        {
-            if (fac == 0) continue;
-
-            point_t p = pos + directions[dir] * fac;
-
-            if (board.outbox(p))
-                continue;
-
-            if (not board.getchess(p) == EMPTY)
-                neigh_cnt++;
-        }
+        ret.set_pattern(BLACK, dir, blk, wht | wall);
+        ret.set_pattern(WHITE, dir, wht, blk | wall);
         ret.neighbors[dir] = neigh_cnt;
     }
+    ret.update_dirs();
     return ret;
 }
 
-chess_state get_state(gomoku_board const& board, int x, int y) { return get_state(board, point_t{x, y}); }
+inline chess_state get_state(gomoku_board const& board, int x, int y) { return get_state(board, point_t{x, y}); }
 
-int evaluate(gomoku_board const& board, gomoku_chess chess)
+inline int evaluate(gomoku_board const& board, gomoku_chess chess)
 {
     int val = 0;
     for (int i = 0; i < 15; i++)
@@ -350,17 +386,39 @@ int evaluate(gomoku_board const& board, gomoku_chess chess)
     return val;
 }
 
-gomoku_chess get_winner(gomoku_board const& board, point_t pos)
+// Window counts summed over all stones of `chess`, the features that
+// evaluate() weighs.
+inline std::array<int, 5> rank_counts(gomoku_board const& board, gomoku_chess chess)
+{
+    std::array<int, 5> counts{};
+    for (int i = 0; i < 15; i++)
+    {
+        for (int j = 0; j < 15; j++)
+        {
+            if (board.getchess(i, j) != chess)
+                continue;
+            auto state = get_state(board, i, j);
+            for (int dir = 0; dir < 4; dir++)
+            {
+                auto p = state.get_pattern(chess, dir);
+                add_rank_counts(p[0], p[1], counts);
+            }
+        }
+    }
+    return counts;
+}
+
+inline gomoku_chess get_winner(gomoku_board const& board, point_t pos)
 {
     auto chess = board.getchess(pos);
 
     if (chess == EMPTY)
         return EMPTY;
 
+    auto state = get_state(board, pos);
     for (int dir = 0; dir < 4; dir++)
     {
-        auto p = get_state(board, pos).get_pattern(chess, dir);
-        if (cal_category(p[0], p[1]) == FIVE)
+        if (get_category(state.get_pattern(chess, dir)) == FIVE)
             return chess;
     }
 
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "batch_eval.hpp"
+#include "board.hpp"
+#include "eval.hpp"
+#include "thread_pool.hpp"
+
+// Checks the batched evaluator against the per-cell one: random boards,
+// from empty to nearly full and with stones on the edges and corners, are
+// scored by evaluate_position and evaluate_batch and compared with evaluate
+// and threat counts built from get_state. Exits with 1 on any mismatch.
+//
+//     nara_evalcheck [boards] [seed]
+
+// threat_summary of one colour counted from get_state
+nara::threat_summary threats_of(nara::gomoku_board const& board, nara::gomoku_chess chess)
+{
+    nara::threat_summary t;
+    for (int i = 0; i < 15; i++)
+    {
+        for (int j = 0; j < 15; j++)
+        {
+            if (board.getchess(i, j) != nara::EMPTY)
+                continue;
+            auto cats = nara::get_state(board, i, j).cats_for(chess);
+            t.fives += cats[nara::FIVE] > 0;
+            t.flex4 += cats[nara::FLEX4] > 0;
+            t.block4 += cats[nara::BLOCK4] > 0;
+            t.flex3 += cats[nara::FLEX3] > 0;
+            t.doubles += cats[nara::BLOCK4] > 1 or (cats[nara::BLOCK4] and cats[nara::FLEX3]) or cats[nara::FLEX3] > 1;
+        }
+    }
+    return t;
+}
+
+bool same_threats(nara::threat_summary const& a, nara::threat_summary const& b)
+{
+    return a.fives == b.fives and a.flex4 == b.flex4 and a.block4 == b.block4 and
+           a.flex3 == b.flex3 and a.doubles == b.doubles;
+}
+
+bool same_eval(nara::position_eval const& a, nara::position_eval const& b)
+{
+    return a.black == b.black and a.white == b.white and
+           same_threats(a.black_threats, b.black_threats) and same_threats(a.white_threats, b.white_threats);
+}
+
+int main(int argc, char *argv[])
+{
+    int count = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 2000;
+    unsigned seed = (argc > 2) ? std::atoi(argv[2]) : 0;
+
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> percent(0, 99);
+
+    std::vector<nara::gomoku_board> boards(count);
+    for (int n = 0; n < count; n++)
+    {
+        int fill = n * 95 / count;
+        for (int i = 0; i < 15; i++)
+        {
+            for (int j = 0; j < 15; j++)
+            {
+                if (percent(gen) < fill)
+                    boards[n].setchess(i, j, percent(gen) < 50 ? nara::BLACK : nara::WHITE);
+            }
+        }
+    }
+
+    nara::thread_pool pool;
+    std::vector<nara::position_eval> batch(count);
+    nara::evaluate_batch(boards, batch, pool, 64);
+
+    long mismatches = 0;
+    for (int n = 0; n < count; n++)
+    {
+        auto const& board = boards[n];
+
+        nara::position_eval expected;
+        expected.black = nara::evaluate(board, nara::BLACK);
+        expected.white = nara::evaluate(board, nara::WHITE);
+        expected.black_threats = threats_of(board, nara::BLACK);
+        expected.white_threats = threats_of(board, nara::WHITE);
+
+        if (not same_eval(nara::evaluate_position(board), expected) or not same_eval(batch[n], expected))
+        {
+            if (mismatches == 0)
+                std::cout << "first mismatch at board " << n << std::endl;
+            mismatches++;
+        }
+    }
+
+    std::cout << count << " boards, " << mismatches << " mismatches" << std::endl;
+    return mismatches ? 1 : 0;
+}
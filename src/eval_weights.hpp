@@ -0,0 +1,20 @@
+#pragma once
+
+// Pattern weights used by cal_rank. This file can be regenerated by
+// nara_tune from labelled positions.
+
+#include <array>
+
+namespace nara
+{
+
+struct eval_weights
+{
+    // score of an open five-cell window through a stone, indexed by how many
+    // other cells of the window hold own stones
+    std::array<int, 5> rank;
+};
+
+constexpr eval_weights default_eval_weights = {{1, 4, 9, 16, 25}};
+
+} // namespace nara
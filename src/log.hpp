@@ -3,5 +3,5 @@
 #include <fstream>
 #include <iostream>
 
-std::ofstream logger;
+inline std::ofstream logger;
 
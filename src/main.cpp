@@ -1,16 +1,25 @@
 #include <cassert>
 #include <ncurses.h>
 
+#include <atomic>
 #include <chrono>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #include "ai.hpp"
 #include "bench.hpp"
 #include "board.hpp"
+#include "book.hpp"
+#include "config.hpp"
 #include "eval.hpp"
 #include "log.hpp"
+#include "nnue.hpp"
+#include "shared_table.hpp"
+#include "thread_pool.hpp"
 
 struct cursor_t
 {
@@ -133,6 +142,8 @@ enum gomoku_action
     LEFT,
     RIGHT,
     CHOOSE,
+    MOVE_NOW,
+    HINT,
     QUIT,
     NONE
 };
@@ -148,6 +159,14 @@ gomoku_action getaction(void)
     case ' ':
         return CHOOSE;
 
+    case 'm':
+    case 'M':
+        return MOVE_NOW;
+
+    case 'h':
+    case 'H':
+        return HINT;
+
     // handle arrow keys, code from https://stackoverflow.com/a/11432632
     case '\033': {
         getch(); // skip the [
@@ -171,6 +190,111 @@ gomoku_action getaction(void)
     }
 }
 
+void display_progress(nara::search_progress const& progress, cursor_t const &cursor)
+{
+    long nps = (progress.ms > 0) ? progress.nodes * 1000 / progress.ms : 0;
+
+    move(19, 0);
+    clrtoeol();
+    printw("depth: %d nodes: %ld nps: %ld best: [%d, %d] score: %d",
+           progress.depth, progress.nodes, nps, progress.best.x, progress.best.y, progress.score);
+    move(20, 0);
+    clrtoeol();
+    printw("thinking... press m to move now");
+    refresh();
+
+    move(cursor.x, cursor.y * 2);
+}
+
+// Runs `job` on a worker thread while the UI stays responsive, calling
+// `redraw` every 100 ms. 'm' sets `cancel`, 'q' sets it and `quit`.
+template <typename F, typename R>
+void run_on_worker(F && job, std::atomic<bool> & cancel, bool & quit, R && redraw)
+{
+    std::atomic<bool> done = false;
+    std::thread worker([&]
+    {
+        job();
+        done = true;
+    });
+
+    timeout(100);
+    while (not done)
+    {
+        gomoku_action action = getaction();
+        if (action == MOVE_NOW or action == QUIT)
+            cancel = true;
+        if (action == QUIT)
+            quit = true;
+        redraw();
+    }
+    timeout(-1);
+
+    worker.join();
+}
+
+// Searches on a worker thread while the UI keeps showing progress. 'm' makes
+// the engine play its best move so far, 'q' stops it and sets `quit`.
+nara::point_t think(nara::gomoku_ai & ai, nara::gomoku_board const& board, cursor_t const &cursor, bool & quit)
+{
+    std::atomic<bool> cancel = false;
+
+    std::mutex progress_mutex;
+    nara::search_progress progress{0, 0, 0, 0, {}};
+
+    nara::search_limits limits;
+    limits.max_depth = 6;
+    limits.cancel = &cancel;
+    limits.on_progress = [&](nara::search_progress const& p)
+    {
+        std::lock_guard lock(progress_mutex);
+        progress = p;
+    };
+
+    nara::point_t next;
+    run_on_worker([&] { next = ai.get_next(board, limits); }, cancel, quit, [&]
+    {
+        std::lock_guard lock(progress_mutex);
+        display_progress(progress, cursor);
+    });
+    return next;
+}
+
+// Shows the best three moves for the player with their expected lines. The
+// analysis runs on a worker thread like think; 'm' abandons it, 'q' also
+// sets `quit`.
+void display_hint(nara::gomoku_ai & adviser, nara::gomoku_board const& board, cursor_t const &cursor,
+                  nara::thread_pool & pool, bool & quit)
+{
+    std::atomic<bool> cancel = false;
+
+    std::vector<nara::gomoku_ai::root_move_t> moves;
+    run_on_worker([&] { moves = adviser.analyse(board, 4, 3, pool, &cancel); }, cancel, quit, [&]
+    {
+        move(20, 0);
+        clrtoeol();
+        printw("analysing... press m to stop");
+        refresh();
+        move(cursor.x, cursor.y * 2);
+    });
+
+    move(20, 0);
+    clrtoeol();
+    for (int i = 0; i < 3; i++)
+    {
+        move(21 + i, 0);
+        clrtoeol();
+        if (i >= (int)moves.size())
+            continue;
+        printw("hint %d: [%d, %d] score: %d line:", i + 1, moves[i].p.x, moves[i].p.y, moves[i].score);
+        for (auto p : moves[i].pv)
+            printw(" [%d, %d]", p.x, p.y);
+    }
+    refresh();
+
+    move(cursor.x, cursor.y * 2);
+}
+
 int main()
 {
     logger.open("LOG");
@@ -193,6 +317,21 @@ int main()
     ai_chess = nara::oppof(my_chess);
 
     nara::gomoku_ai ai = nara::gomoku_ai(ai_chess);
+    nara::gomoku_ai adviser = nara::gomoku_ai(my_chess);
+    nara::thread_pool pool;
+    ai.set_log(&logger);
+
+    nara::opening_book book;
+    if (book.open("nara.book"))
+        ai.set_book(&book);
+
+    nara::nnue_network network;
+    if (network.load("nara.nnue"))
+        ai.set_network(&network);
+
+    nara::shared_result_table shared_table;
+    if (const char *name = std::getenv("NARA_SHARED_TABLE"); name and shared_table.open(name))
+        ai.set_shared_table(&shared_table);
 
     initscr();
     display(board, cursor);
@@ -204,15 +343,19 @@ int main()
         if (turn == ai_chess)
         {
             nara::point_t ai_next;
+            bool quit = false;
 
-            auto start = std::chrono::system_clock::now();
+            auto start = std::chrono::steady_clock::now();
 
-            ai_next = ai.get_next(board);
+            ai_next = think(ai, board, cursor, quit);
 
-            auto end = std::chrono::system_clock::now();
+            auto end = std::chrono::steady_clock::now();
             logger << std::chrono::duration_cast<std::chrono::milliseconds>(end - start) << std::endl;
             logger.flush();
 
+            if (quit)
+                goto quit;
+
             last_move = ai_next;
 
             if (board.getchess(ai_next) != nara::EMPTY)
@@ -228,6 +371,14 @@ int main()
                 gomoku_action action = getaction();
                 if (action == QUIT)
                     goto quit;
+                if (action == HINT)
+                {
+                    bool quit = false;
+                    display_hint(adviser, board, cursor, pool, quit);
+                    if (quit)
+                        goto quit;
+                    continue;
+                }
                 if (action == CHOOSE)
                 {
                     if (board.getchess(cursor.x, cursor.y) == nara::EMPTY)
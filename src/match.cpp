@@ -0,0 +1,165 @@
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ai.hpp"
+#include "bench.hpp"
+#include "board.hpp"
+#include "config.hpp"
+#include "eval.hpp"
+#include "log.hpp"
+
+// Plays engine A against engine B to measure what a search feature costs in
+// nodes and time and what it buys in results. Games are played in pairs from
+// the same random opening with colours swapped.
+//
+//     nara_match [games] [depth] [features of A] [features of B]
+//
+// A depth like "200ms" plays with that time budget per move instead, and
+// reports how much of it the time manager allocated and used.
+//
+// Features are a comma separated list of: null, lmr, futility, qs, ext,
+// singular, mcts.
+
+nara::search_config parse_config(std::string const& features)
+{
+    nara::search_config config;
+    std::stringstream ss(features);
+    std::string f;
+    while (std::getline(ss, f, ','))
+    {
+        if (f == "null")
+            config.null_move = true;
+        else if (f == "lmr")
+            config.late_move_reduction = true;
+        else if (f == "futility")
+            config.futility = true;
+        else if (f == "qs")
+            config.quiescence = true;
+        else if (f == "ext")
+            config.extensions = true;
+        else if (f == "singular")
+            config.singular_extension = true;
+        else if (f == "mcts")
+            config.backend = nara::MCTS;
+        else if (not f.empty() and f != "none")
+            std::cerr << "unknown feature: " << f << std::endl;
+    }
+    return config;
+}
+
+struct side_stat
+{
+    int wins = 0;
+    long nodes = 0;
+    long moves = 0;
+    long ms = 0;
+    long max_ms = 0;
+    long allocated_ms = 0;
+    nara::perf_sample counters{};
+};
+
+int main(int argc, char *argv[])
+{
+    int games = (argc > 1) ? std::atoi(argv[1]) : 10;
+    std::string depth_arg = (argc > 2) ? argv[2] : "4";
+    bool timed = depth_arg.ends_with("ms");
+    int depth = std::atoi(depth_arg.c_str());
+
+    nara::search_limits limits;
+    limits.max_depth = 30;
+    if (timed)
+        limits.move_time_ms = depth;
+    auto config_a = parse_config((argc > 3) ? argv[3] : "none");
+    auto config_b = parse_config((argc > 4) ? argv[4] : "none");
+
+    logger.open("LOG");
+
+    side_stat stat_a, stat_b;
+    int draws = 0;
+    std::mt19937 gen(0);
+
+    std::vector<nara::point_t> opening;
+    for (int g = 0; g < games; g++)
+    {
+        bool a_is_black = g % 2 == 0;
+        if (a_is_black)
+        {
+            std::uniform_int_distribution<int> near(5, 9);
+            opening = {{7, 7}, {near(gen), near(gen)}};
+            if (opening[1] == opening[0])
+                opening.pop_back();
+        }
+
+        nara::gomoku_ai ai_blk(nara::BLACK);
+        nara::gomoku_ai ai_wht(nara::WHITE);
+        ai_blk.set_log(&logger);
+        ai_wht.set_log(&logger);
+        ai_blk.set_config(a_is_black ? config_a : config_b);
+        ai_wht.set_config(a_is_black ? config_b : config_a);
+
+        nara::gomoku_board board;
+        nara::gomoku_chess turn = nara::BLACK;
+        for (auto p : opening)
+        {
+            board.setchess(p, turn);
+            turn = nara::oppof(turn);
+        }
+
+        nara::gomoku_chess winner = nara::EMPTY;
+        for (int ply = opening.size(); ply < 15 * 15 and winner == nara::EMPTY; ply++)
+        {
+            auto & ai = (turn == nara::BLACK) ? ai_blk : ai_wht;
+            auto & stat = ((turn == nara::BLACK) == a_is_black) ? stat_a : stat_b;
+
+            nara::point_t p;
+            long ms = benchmark([&] { p = timed ? ai.search(board, limits).p : ai.search(board, depth).p; },
+                                stat.counters).count();
+            stat.ms += ms;
+            stat.max_ms = std::max(stat.max_ms, ms);
+            if (timed)
+                stat.allocated_ms += ai.get_time_report().allocated_ms;
+            stat.nodes += ai.get_stats().nodes;
+            stat.moves++;
+
+            board.setchess(p, turn);
+            winner = nara::get_winner(board, p);
+            turn = nara::oppof(turn);
+        }
+
+        if (winner == nara::EMPTY)
+            draws++;
+        else if ((winner == nara::BLACK) == a_is_black)
+            stat_a.wins++;
+        else
+            stat_b.wins++;
+
+        std::cout << "game " << g + 1 << "/" << games << ": A " << stat_a.wins
+                  << " B " << stat_b.wins << " draw " << draws << std::endl;
+    }
+
+    for (auto [name, stat] : {std::make_pair("A", stat_a), std::make_pair("B", stat_b)})
+    {
+        std::cout << name << ": " << stat.wins << " wins, "
+                  << stat.nodes / std::max(stat.moves, 1L) << " nodes/move, "
+                  << (double)stat.ms / std::max(stat.moves, 1L) << " ms/move, "
+                  << stat.max_ms << " ms max" << std::endl;
+        if (timed)
+        {
+            std::cout << name << ": " << (double)stat.allocated_ms / std::max(stat.moves, 1L)
+                      << " ms/move allocated of " << depth << std::endl;
+        }
+        if (nara::perf_enabled)
+        {
+            std::cout << name << ": ";
+            nara::print_sample(std::cout, stat.counters);
+            std::cout << std::endl;
+        }
+    }
+
+    logger.close();
+    return 0;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "board.hpp"
+
+namespace nara
+{
+
+// The tree of the Monte Carlo search, shared by all its threads without
+// locks. Nodes come from one preallocated array: a thread that expands a
+// node claims a run of slots with one atomic add, fills in the children and
+// publishes them with a release store of the node's state. Values are kept
+// for the player who made the move leading to the node.
+
+enum mcts_state : uint8_t
+{
+    MCTS_UNEXPANDED,
+    MCTS_EXPANDING,
+    MCTS_EXPANDED,
+
+    // the tree is full, the node stays a leaf
+    MCTS_LEAF,
+};
+
+struct mcts_node
+{
+    std::atomic<int> visits;
+    std::atomic<float> value;
+    std::atomic<uint8_t> state;
+
+    // set before the node is published
+    point_t move;
+    float prior;
+    bool wins;
+    uint32_t first_child;
+    uint32_t child_count;
+
+    void init(point_t _move, float _prior, bool _wins)
+    {
+        visits.store(0, std::memory_order_relaxed);
+        value.store(0, std::memory_order_relaxed);
+        state.store(MCTS_UNEXPANDED, std::memory_order_relaxed);
+        move = _move;
+        prior = _prior;
+        wins = _wins;
+        first_child = 0;
+        child_count = 0;
+    }
+};
+
+class mcts_tree
+{
+  private:
+
+    std::unique_ptr<mcts_node[]> nodes;
+    size_t capacity = 0;
+    std::atomic<size_t> used = 0;
+
+  public:
+
+    // Empties the tree, keeping the allocation if it is large enough.
+    void reset(size_t _capacity)
+    {
+        if (capacity < _capacity)
+        {
+            nodes = std::make_unique<mcts_node[]>(_capacity);
+            capacity = _capacity;
+        }
+        nodes[0].init({7, 7}, 1, false);
+        used = 1;
+    }
+
+    mcts_node & root() { return nodes[0]; }
+
+    mcts_node *at(uint32_t index) { return &nodes[index]; }
+
+    mcts_node *children(mcts_node const& node) { return at(node.first_child); }
+
+    size_t size() const { return std::min(used.load(std::memory_order_relaxed), capacity); }
+
+    // Index of `n` free nodes, or 0 when the tree is full.
+    uint32_t allocate(size_t n)
+    {
+        size_t first = used.fetch_add(n, std::memory_order_relaxed);
+        return (first + n <= capacity) ? first : 0;
+    }
+
+    // PUCT: the child with the best mean value plus an exploration bonus
+    // that grows with its prior and shrinks with its visits. Unvisited
+    // children count as slightly losing, so that strong priors go first.
+    mcts_node & select(mcts_node const& node, float cpuct)
+    {
+        mcts_node *first = children(node);
+        float sqrt_visits = std::sqrt((float)std::max(node.visits.load(std::memory_order_relaxed), 1));
+
+        mcts_node *best = first;
+        float best_score = -1e9f;
+        for (uint32_t i = 0; i < node.child_count; i++)
+        {
+            auto & child = first[i];
+            int visits = child.visits.load(std::memory_order_relaxed);
+            float q = (visits > 0) ? child.value.load(std::memory_order_relaxed) / visits : -0.2f;
+            float score = q + cpuct * child.prior * sqrt_visits / (1 + visits);
+            if (score > best_score)
+            {
+                best_score = score;
+                best = &child;
+            }
+        }
+        return *best;
+    }
+};
+
+} // namespace nara
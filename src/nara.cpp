@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "nara.h"
+
+#include "ai.hpp"
+#include "batch_eval.hpp"
+#include "board.hpp"
+#include "config.hpp"
+#include "snapshot.hpp"
+#include "thread_pool.hpp"
+
+static_assert(int(NARA_EMPTY) == nara::EMPTY and int(NARA_BLACK) == nara::BLACK and int(NARA_WHITE) == nara::WHITE);
+
+// The engine behind the C interface. A gomoku_ai searches for a fixed colour,
+// so one is created per colour on first use and kept with its tables.
+struct nara_engine
+{
+    nara::gomoku_board board;
+    nara::gomoku_chess side = nara::BLACK;
+    std::unique_ptr<nara::gomoku_ai> ai[2];
+
+    std::atomic<bool> cancel = false;
+
+    bool has_result = false;
+    nara_result result{};
+};
+
+struct nara_evaluator
+{
+    nara::thread_pool pool;
+
+    explicit nara_evaluator(int threads) : pool(threads) {}
+};
+
+namespace
+{
+
+nara::gomoku_ai & engine_for(nara_engine & engine, nara::gomoku_chess side)
+{
+    auto & ai = engine.ai[side == nara::BLACK ? 0 : 1];
+    if (not ai)
+        ai = std::make_unique<nara::gomoku_ai>(side);
+    return *ai;
+}
+
+// The sizes of the first versioned structs, the least a caller may pass.
+const size_t limits_min_size = offsetof(nara_limits, max_nodes) + sizeof(long);
+const size_t result_min_size = offsetof(nara_result, nodes) + sizeof(long);
+
+// A caller's struct as this build declares it: the fields its struct_size
+// covers, and zeros, the defaults, for fields it predates.
+template <typename T>
+T read_struct(const T *in)
+{
+    T out{};
+    std::memcpy(&out, in, std::min<size_t>(in->struct_size, sizeof(T)));
+    out.struct_size = sizeof(T);
+    return out;
+}
+
+// Writes the fields a caller's struct has room for.
+template <typename T>
+void write_struct(T *out, T const& in)
+{
+    uint32_t size = out->struct_size;
+    std::memcpy(out, &in, std::min<size_t>(size, sizeof(T)));
+    out->struct_size = size;
+}
+
+} // namespace
+
+extern "C" {
+
+unsigned nara_version(void)
+{
+    return NARA_VERSION;
+}
+
+nara_engine *nara_create(void)
+{
+    return new (std::nothrow) nara_engine;
+}
+
+void nara_destroy(nara_engine *engine)
+{
+    delete engine;
+}
+
+int nara_set_position(nara_engine *engine, const unsigned char *cells, int side)
+{
+    if (not engine or not cells or (side != NARA_BLACK and side != NARA_WHITE))
+        return NARA_EINVAL;
+
+    for (int i = 0; i < 15 * 15; i++)
+    {
+        if (cells[i] > NARA_WHITE)
+            return NARA_EINVAL;
+    }
+
+    for (int i = 0; i < 15 * 15; i++)
+        engine->board.setchess(i / 15, i % 15, nara::gomoku_chess(cells[i]));
+    engine->side = nara::gomoku_chess(side);
+    engine->has_result = false;
+    return NARA_OK;
+}
+
+int nara_search(nara_engine *engine, const nara_limits *limits, nara_result *result)
+{
+    if (not engine or not limits or limits->struct_size < limits_min_size or
+        (result and result->struct_size < result_min_size))
+        return NARA_EINVAL;
+
+    auto l = read_struct(limits);
+    if (l.max_depth < 1 or l.max_nodes < 0 or l.move_time_ms < 0 or l.max_time_ms < 0)
+        return NARA_EINVAL;
+
+    bool full = true;
+    for (int i = 0; i < 15 * 15 and full; i++)
+        full = engine->board.getchess(i / 15, i % 15) != nara::EMPTY;
+    if (full)
+        return NARA_ENOMOVE;
+
+    int status = NARA_OK;
+    try
+    {
+        auto & ai = engine_for(*engine, engine->side);
+
+        nara::search_limits search_limits;
+        search_limits.max_depth = l.max_depth;
+        search_limits.max_nodes = l.max_nodes;
+        search_limits.move_time_ms = l.move_time_ms;
+        search_limits.max_time_ms = l.max_time_ms;
+        search_limits.cancel = &engine->cancel;
+
+        auto res = ai.search(engine->board, search_limits);
+        engine->result = nara_result{sizeof(nara_result), res.p.x, res.p.y, res.score, res.depth,
+                                     ai.get_stats().nodes};
+        engine->has_result = true;
+        if (result)
+            write_struct(result, engine->result);
+    }
+    catch (std::bad_alloc const&)
+    {
+        status = NARA_ENOMEM;
+    }
+    catch (...)
+    {
+        status = NARA_EINTERNAL;
+    }
+
+    engine->cancel = false;
+    return status;
+}
+
+int nara_get_result(const nara_engine *engine, nara_result *result)
+{
+    if (not engine or not result or result->struct_size < result_min_size)
+        return NARA_EINVAL;
+    if (not engine->has_result)
+        return NARA_ENORESULT;
+    write_struct(result, engine->result);
+    return NARA_OK;
+}
+
+void nara_cancel(nara_engine *engine)
+{
+    if (engine)
+        engine->cancel = true;
+}
+
+// An engine snapshot is the 225 cells, the side to move, whether there is a
+// result and the nara_result, then for each colour the length of its
+// gomoku_ai snapshot (0 if it was never used) and the snapshot.
+
+int nara_snapshot(nara_engine *engine, size_t tt_entries, unsigned char *buf, size_t size, size_t *length)
+{
+    if (not engine or not length)
+        return NARA_EINVAL;
+
+    try
+    {
+        std::vector<uint8_t> out;
+        for (int i = 0; i < 15 * 15; i++)
+            out.push_back(engine->board.getchess(i / 15, i % 15));
+        out.push_back(engine->side);
+        out.push_back(engine->has_result);
+        nara::detail::put_raw(out, engine->result);
+
+        for (auto & ai : engine->ai)
+        {
+            auto blob = ai ? ai->snapshot(tt_entries) : std::vector<uint8_t>();
+            nara::detail::put_raw(out, uint64_t(blob.size()));
+            out.insert(out.end(), blob.begin(), blob.end());
+        }
+
+        *length = out.size();
+        if (not buf or size < out.size())
+            return NARA_ERANGE;
+        std::memcpy(buf, out.data(), out.size());
+        return NARA_OK;
+    }
+    catch (std::bad_alloc const&)
+    {
+        return NARA_ENOMEM;
+    }
+    catch (...)
+    {
+        return NARA_EINTERNAL;
+    }
+}
+
+int nara_restore(nara_engine *engine, const unsigned char *buf, size_t size)
+{
+    if (not engine or not buf)
+        return NARA_EINVAL;
+
+    try
+    {
+        std::span<const uint8_t> in(buf, size);
+        if (in.size() < 15 * 15 + 2)
+            return NARA_EINVAL;
+
+        nara::gomoku_board board;
+        for (int i = 0; i < 15 * 15; i++)
+        {
+            if (in[i] > NARA_WHITE)
+                return NARA_EINVAL;
+            board.setchess(i / 15, i % 15, nara::gomoku_chess(in[i]));
+        }
+        int side = in[15 * 15];
+        bool has_result = in[15 * 15 + 1];
+        in = in.subspan(15 * 15 + 2);
+        if (side != NARA_BLACK and side != NARA_WHITE)
+            return NARA_EINVAL;
+
+        nara_result result;
+        if (not nara::detail::get_raw(in, result))
+            return NARA_EINVAL;
+
+        // restored into new engines first, so a bad blob changes nothing
+        std::unique_ptr<nara::gomoku_ai> ai[2];
+        for (int c = 0; c < 2; c++)
+        {
+            uint64_t length;
+            if (not nara::detail::get_raw(in, length) or length > in.size())
+                return NARA_EINVAL;
+            if (length)
+            {
+                ai[c] = std::make_unique<nara::gomoku_ai>(c == 0 ? nara::BLACK : nara::WHITE);
+                if (not ai[c]->restore(in.first(length)))
+                    return NARA_EINVAL;
+            }
+            in = in.subspan(length);
+        }
+        if (not in.empty())
+            return NARA_EINVAL;
+
+        for (int i = 0; i < 15 * 15; i++)
+            engine->board.setchess(i / 15, i % 15, board.getchess(i / 15, i % 15));
+        engine->side = nara::gomoku_chess(side);
+        engine->has_result = has_result;
+        engine->result = result;
+        engine->ai[0] = std::move(ai[0]);
+        engine->ai[1] = std::move(ai[1]);
+        return NARA_OK;
+    }
+    catch (std::bad_alloc const&)
+    {
+        return NARA_ENOMEM;
+    }
+    catch (...)
+    {
+        return NARA_EINTERNAL;
+    }
+}
+
+nara_evaluator *nara_evaluator_create(int threads)
+{
+    if (threads < 0)
+        return nullptr;
+    try
+    {
+        return threads ? new nara_evaluator(threads) : new nara_evaluator(std::thread::hardware_concurrency());
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void nara_evaluator_destroy(nara_evaluator *evaluator)
+{
+    delete evaluator;
+}
+
+int nara_evaluate_batch(nara_evaluator *evaluator, const unsigned char *cells, size_t count, nara_eval *out)
+{
+    if (not evaluator or (count and (not cells or not out)))
+        return NARA_EINVAL;
+
+    for (size_t i = 0; i < count * 15 * 15; i++)
+    {
+        if (cells[i] > NARA_WHITE)
+            return NARA_EINVAL;
+    }
+
+    auto threats = [](nara::threat_summary const& t)
+    {
+        return nara_threats{t.fives, t.flex4, t.block4, t.flex3, t.doubles};
+    };
+
+    // chunks of boards, so workers don't contend for every index
+    const size_t chunk = 256;
+    evaluator->pool.parallel_for((count + chunk - 1) / chunk, [&](int, size_t c)
+    {
+        size_t end = std::min(count, (c + 1) * chunk);
+        for (size_t i = c * chunk; i < end; i++)
+        {
+            auto e = nara::evaluate_position(cells + i * 15 * 15);
+            out[i] = nara_eval{e.black, e.white, threats(e.black_threats), threats(e.white_threats)};
+        }
+    });
+    return NARA_OK;
+}
+
+const char *nara_strerror(int status)
+{
+    switch (status)
+    {
+    case NARA_OK:        return "success";
+    case NARA_EINVAL:    return "invalid argument";
+    case NARA_ENOMOVE:   return "no legal move";
+    case NARA_ENORESULT: return "no search result";
+    case NARA_ENOMEM:    return "out of memory";
+    case NARA_EINTERNAL: return "internal error";
+    case NARA_ERANGE:    return "buffer too small";
+    default:             return "unknown status";
+    }
+}
+
+} // extern "C"
@@ -0,0 +1,140 @@
+#ifndef NARA_H
+#define NARA_H
+
+/*
+ * C interface to the engine, built as libnara. Every engine is independent:
+ * different engines can be used from different threads at the same time, and
+ * the library keeps no mutable global state. One engine must not be used from
+ * two threads at once, except for nara_cancel.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The version of this interface, raised whenever a function or a field is
+ * added. nara_version() returns the version of the library itself. */
+#define NARA_VERSION 3
+
+typedef struct nara_engine nara_engine;
+typedef struct nara_evaluator nara_evaluator;
+
+/* cell values */
+enum
+{
+    NARA_EMPTY = 0,
+    NARA_BLACK = 1,
+    NARA_WHITE = 2
+};
+
+/* status codes */
+enum
+{
+    NARA_OK = 0,
+    NARA_EINVAL = -1,     /* bad argument */
+    NARA_ENOMOVE = -2,    /* the board is full */
+    NARA_ENORESULT = -3,  /* no search has finished since the last position */
+    NARA_ENOMEM = -4,
+    NARA_EINTERNAL = -5,
+    NARA_ERANGE = -6      /* the buffer is too small */
+};
+
+/* Structs passed to the library start with `struct_size`, which the caller
+ * sets to sizeof the struct as its nara.h declares it. Fields later versions
+ * add are then left at their defaults for older callers, and not written for
+ * them. */
+
+typedef struct nara_limits
+{
+    uint32_t struct_size;
+    int max_depth;        /* deepest iteration, at least 1 */
+    long max_nodes;       /* node budget after the first iteration, 0 for none */
+    long move_time_ms;    /* time budget of the move, 0 for none (version 3) */
+    long max_time_ms;     /* hard time limit, 0 for three times the budget */
+} nara_limits;
+
+typedef struct nara_result
+{
+    uint32_t struct_size;
+    int x;
+    int y;
+    int score;            /* from the point of view of the side to move */
+    int depth;
+    long nodes;
+} nara_result;
+
+/* Empty cells where a move of one side makes a five, an open four, any other
+ * four, an open three, or two of the fours and open threes at once. */
+typedef struct nara_threats
+{
+    int fives;
+    int flex4;
+    int block4;
+    int flex3;
+    int doubles;
+} nara_threats;
+
+typedef struct nara_eval
+{
+    int black;            /* static score of each colour's stones */
+    int white;
+    nara_threats black_threats;
+    nara_threats white_threats;
+} nara_eval;
+
+unsigned nara_version(void);
+
+nara_engine *nara_create(void);
+
+void nara_destroy(nara_engine *engine);
+
+/* `cells` holds 15 * 15 cell values, cells[x * 15 + y]; `side` is the colour
+ * to move. */
+int nara_set_position(nara_engine *engine, const unsigned char *cells, int side);
+
+/* Searches the current position and stores the best move in `result`, which
+ * may be NULL. A cancelled search returns the deepest finished iteration.
+ * NARA_EINVAL if a struct_size is smaller than the first versioned struct. */
+int nara_search(nara_engine *engine, const nara_limits *limits, nara_result *result);
+
+/* The result of the last search of the current position. */
+int nara_get_result(const nara_engine *engine, nara_result *result);
+
+/* Stops the search running on `engine`, or the next one if none is running;
+ * safe to call from any thread. */
+void nara_cancel(nara_engine *engine);
+
+/* Saves the position, the last result and the search state of both colours,
+ * with up to `tt_entries` transposition table entries each, into `buf`.
+ * `*length` is set to the size needed; when `size` is smaller nothing is
+ * written and NARA_ERANGE is returned, so a NULL `buf` asks for the size.
+ * Snapshots restore only into the same build of the library. */
+int nara_snapshot(nara_engine *engine, size_t tt_entries, unsigned char *buf, size_t size, size_t *length);
+
+/* Replaces the state of `engine` with a snapshot, so that a session moved to
+ * another process resumes with warm tables. On error the engine is
+ * unchanged. */
+int nara_restore(nara_engine *engine, const unsigned char *buf, size_t size);
+
+/* A set of `threads` workers (0 for one per core) for static evaluation.
+ * An evaluator keeps no positions; like an engine it must not be used from
+ * two threads at once. */
+nara_evaluator *nara_evaluator_create(int threads);
+
+void nara_evaluator_destroy(nara_evaluator *evaluator);
+
+/* Evaluates `count` boards laid out one after another, 15 * 15 cell values
+ * each as in nara_set_position, into out[0] to out[count - 1]. Allocates
+ * nothing; on error nothing is written. */
+int nara_evaluate_batch(nara_evaluator *evaluator, const unsigned char *cells, size_t count, nara_eval *out);
+
+const char *nara_strerror(int status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NARA_H */
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+#include "board.hpp"
+
+namespace nara
+{
+
+// A small quantized network as an alternative to the pattern evaluation.
+//
+// The input layer has one feature per point and owner, seen from each side:
+// for the BLACK perspective a black stone on point i is feature i and a white
+// one is feature 225 + i, and the other way round for WHITE. Its outputs are
+// kept in an accumulator that gomoku_ai updates as stones come and go, so the
+// first layer costs one vector add per move. The rest of the network runs on
+// the two accumulators, own perspective first:
+//
+//     2 * hidden (clipped to 0..127) -> l2 (int8 weights) -> 1 (int8 weights)
+
+struct nnue_weights
+{
+    static constexpr int inputs = 2 * 15 * 15;
+    static constexpr int hidden = 64;
+    static constexpr int l2 = 32;
+
+    // shifts from the int32 sums back to the activation range
+    static constexpr int l2_shift = 6;
+    static constexpr int out_shift = 4;
+
+    alignas(32) int16_t w1[inputs][hidden];
+    alignas(32) int16_t b1[hidden];
+    alignas(32) int8_t w2[l2][2 * hidden];
+    alignas(32) int32_t b2[l2];
+    alignas(32) int8_t w3[l2];
+    int32_t b3;
+};
+
+struct nnue_accumulator
+{
+    alignas(32) int16_t v[2][nnue_weights::hidden];
+};
+
+const char nnue_magic[8] = {'N', 'A', 'R', 'A', 'N', 'N', 'U', 'E'};
+const uint32_t nnue_version = 1;
+
+namespace detail
+{
+
+inline void add_row(int16_t *acc, const int16_t *row)
+{
+#if defined(__AVX2__)
+    for (int i = 0; i < nnue_weights::hidden; i += 16)
+    {
+        auto a = _mm256_load_si256(reinterpret_cast<const __m256i *>(acc + i));
+        auto r = _mm256_load_si256(reinterpret_cast<const __m256i *>(row + i));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(acc + i), _mm256_add_epi16(a, r));
+    }
+#else
+    for (int i = 0; i < nnue_weights::hidden; i++)
+        acc[i] += row[i];
+#endif
+}
+
+inline void sub_row(int16_t *acc, const int16_t *row)
+{
+#if defined(__AVX2__)
+    for (int i = 0; i < nnue_weights::hidden; i += 16)
+    {
+        auto a = _mm256_load_si256(reinterpret_cast<const __m256i *>(acc + i));
+        auto r = _mm256_load_si256(reinterpret_cast<const __m256i *>(row + i));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(acc + i), _mm256_sub_epi16(a, r));
+    }
+#else
+    for (int i = 0; i < nnue_weights::hidden; i++)
+        acc[i] -= row[i];
+#endif
+}
+
+// Clamps n int16 values to 0..127 into bytes, keeping their order.
+inline void clip(uint8_t *out, const int16_t *in, int n)
+{
+#if defined(__AVX2__)
+    for (int i = 0; i < n; i += 32)
+    {
+        auto a = _mm256_load_si256(reinterpret_cast<const __m256i *>(in + i));
+        auto b = _mm256_load_si256(reinterpret_cast<const __m256i *>(in + i + 16));
+        auto packed = _mm256_packus_epi16(a, b);
+        packed = _mm256_min_epu8(packed, _mm256_set1_epi8(127));
+        packed = _mm256_permute4x64_epi64(packed, 0b11011000);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(out + i), packed);
+    }
+#else
+    for (int i = 0; i < n; i++)
+        out[i] = std::clamp<int16_t>(in[i], 0, 127);
+#endif
+}
+
+// Dot product of n unsigned activations (0..127) with int8 weights; n is a
+// multiple of 32 and both arrays are 32-byte aligned.
+inline int32_t dot(const uint8_t *a, const int8_t *w, int n)
+{
+#if defined(__AVX2__)
+    auto sum = _mm256_setzero_si256();
+    const auto ones = _mm256_set1_epi16(1);
+    for (int i = 0; i < n; i += 32)
+    {
+        auto va = _mm256_load_si256(reinterpret_cast<const __m256i *>(a + i));
+        auto vw = _mm256_load_si256(reinterpret_cast<const __m256i *>(w + i));
+        auto prod = _mm256_madd_epi16(_mm256_maddubs_epi16(va, vw), ones);
+        sum = _mm256_add_epi32(sum, prod);
+    }
+    auto s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0b01001110));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0b10110001));
+    return _mm_cvtsi128_si32(s);
+#elif defined(__SSSE3__)
+    auto sum = _mm_setzero_si128();
+    const auto ones = _mm_set1_epi16(1);
+    for (int i = 0; i < n; i += 16)
+    {
+        auto va = _mm_load_si128(reinterpret_cast<const __m128i *>(a + i));
+        auto vw = _mm_load_si128(reinterpret_cast<const __m128i *>(w + i));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(va, vw), ones));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0b01001110));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0b10110001));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+    for (int i = 0; i < n; i++)
+        sum += a[i] * w[i];
+    return sum;
+#endif
+}
+
+} // namespace detail
+
+class nnue_network
+{
+  private:
+
+    std::unique_ptr<nnue_weights> weights;
+
+    static int perspective(gomoku_chess chess) { return (chess == BLACK) ? 0 : 1; }
+
+    const int16_t *row(int persp, point_t p, gomoku_chess chess) const
+    {
+        int own = (perspective(chess) == persp) ? 0 : 15 * 15;
+        return weights->w1[own + p.x * 15 + p.y];
+    }
+
+  public:
+
+    using W = nnue_weights;
+
+    // File layout: magic, version, then w1, b1, w2, b2, w3 and b3 as raw
+    // little-endian arrays in declaration order.
+    bool load(std::string const& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (not in)
+            return false;
+
+        char magic[8];
+        uint32_t version;
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char *>(&version), sizeof(version));
+        if (not in or std::memcmp(magic, nnue_magic, sizeof(magic)) != 0 or version != nnue_version)
+            return false;
+
+        auto w = std::make_unique<nnue_weights>();
+        in.read(reinterpret_cast<char *>(w->w1), sizeof(w->w1));
+        in.read(reinterpret_cast<char *>(w->b1), sizeof(w->b1));
+        in.read(reinterpret_cast<char *>(w->w2), sizeof(w->w2));
+        in.read(reinterpret_cast<char *>(w->b2), sizeof(w->b2));
+        in.read(reinterpret_cast<char *>(w->w3), sizeof(w->w3));
+        in.read(reinterpret_cast<char *>(&w->b3), sizeof(w->b3));
+        if (not in)
+            return false;
+
+        weights = std::move(w);
+        return true;
+    }
+
+    bool save(std::string const& path) const
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (not out or not weights)
+            return false;
+
+        out.write(nnue_magic, sizeof(nnue_magic));
+        out.write(reinterpret_cast<const char *>(&nnue_version), sizeof(nnue_version));
+        out.write(reinterpret_cast<const char *>(weights->w1), sizeof(weights->w1));
+        out.write(reinterpret_cast<const char *>(weights->b1), sizeof(weights->b1));
+        out.write(reinterpret_cast<const char *>(weights->w2), sizeof(weights->w2));
+        out.write(reinterpret_cast<const char *>(weights->b2), sizeof(weights->b2));
+        out.write(reinterpret_cast<const char *>(weights->w3), sizeof(weights->w3));
+        out.write(reinterpret_cast<const char *>(&weights->b3), sizeof(weights->b3));
+        return bool(out);
+    }
+
+    // Gives write access for tools that produce weights.
+    nnue_weights & mutable_weights()
+    {
+        if (not weights)
+            weights = std::make_unique<nnue_weights>();
+        return *weights;
+    }
+
+    bool loaded() const { return weights != nullptr; }
+
+    void reset(nnue_accumulator & acc, gomoku_board const& board) const
+    {
+        for (int persp = 0; persp < 2; persp++)
+            std::copy(weights->b1, weights->b1 + W::hidden, acc.v[persp]);
+
+        for (int i = 0; i < 15; i++)
+            for (int j = 0; j < 15; j++)
+                if (board.getchess(i, j) != EMPTY)
+                    add(acc, {i, j}, board.getchess(i, j));
+    }
+
+    void add(nnue_accumulator & acc, point_t p, gomoku_chess chess) const
+    {
+        detail::add_row(acc.v[0], row(0, p, chess));
+        detail::add_row(acc.v[1], row(1, p, chess));
+    }
+
+    void remove(nnue_accumulator & acc, point_t p, gomoku_chess chess) const
+    {
+        detail::sub_row(acc.v[0], row(0, p, chess));
+        detail::sub_row(acc.v[1], row(1, p, chess));
+    }
+
+    // Score of the position for `chess`.
+    int evaluate(nnue_accumulator const& acc, gomoku_chess chess) const
+    {
+        alignas(32) uint8_t in[2 * W::hidden];
+        alignas(32) uint8_t h2[W::l2];
+
+        int persp = perspective(chess);
+        detail::clip(in, acc.v[persp], W::hidden);
+        detail::clip(in + W::hidden, acc.v[1 - persp], W::hidden);
+
+        for (int o = 0; o < W::l2; o++)
+        {
+            int32_t sum = weights->b2[o] + detail::dot(in, weights->w2[o], 2 * W::hidden);
+            h2[o] = std::clamp(sum >> W::l2_shift, 0, 127);
+        }
+
+        return (weights->b3 + detail::dot(h2, weights->w3, W::l2)) >> W::out_shift;
+    }
+};
+
+} // namespace nara
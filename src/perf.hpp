@@ -0,0 +1,224 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <utility>
+
+#ifdef NARA_PERF
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace nara
+{
+
+// Hardware counters (Linux perf_event_open) around regions of the search,
+// enabled by building with NARA_PERF (cmake -DNARA_PERF=ON). Without it
+// NARA_PERF_SCOPE expands to nothing and every count stays zero. Each scope
+// reads the counters twice, a system call each, so enabled builds are slower
+// and the counts include some of that overhead.
+
+#ifdef NARA_PERF
+constexpr bool perf_enabled = true;
+#else
+constexpr bool perf_enabled = false;
+#endif
+
+enum perf_event
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_EVENTS
+};
+
+enum perf_region
+{
+    REGION_MOVE_GEN,
+    REGION_MAKE_UNMAKE,
+    REGION_EVALUATE,
+    REGION_TT_PROBE,
+    PERF_REGIONS
+};
+
+inline const char *const perf_event_names[PERF_EVENTS] = {
+    "cycles", "instructions", "L1d misses", "LLC misses", "branch misses"};
+
+inline const char *const perf_region_names[PERF_REGIONS] = {
+    "move gen", "make/unmake", "evaluate", "tt probe"};
+
+using perf_sample = std::array<uint64_t, PERF_EVENTS>;
+
+inline void print_sample(std::ostream & os, perf_sample const& s)
+{
+    for (int e = 0; e < PERF_EVENTS; e++)
+        os << (e ? ", " : "") << perf_event_names[e] << " " << s[e];
+    if (s[PERF_CYCLES])
+        os << ", IPC " << (double)s[PERF_INSTRUCTIONS] / (double)s[PERF_CYCLES];
+}
+
+// Counts per region, summed over all scopes of one search. Regions may nest,
+// e.g. make/unmake inside move gen, so the totals are inclusive.
+struct perf_profile
+{
+    std::array<perf_sample, PERF_REGIONS> totals{};
+    std::array<uint64_t, PERF_REGIONS> calls{};
+
+    void reset() { *this = perf_profile{}; }
+
+    void add(perf_region region, perf_sample const& begin, perf_sample const& end)
+    {
+        for (int e = 0; e < PERF_EVENTS; e++)
+            totals[region][e] += end[e] - begin[e];
+        calls[region]++;
+    }
+
+    void report(std::ostream & os) const
+    {
+        for (int r = 0; r < PERF_REGIONS; r++)
+        {
+            os << perf_region_names[r] << ": " << calls[r] << " calls, ";
+            print_sample(os, totals[r]);
+            os << std::endl;
+        }
+    }
+};
+
+#ifdef NARA_PERF
+
+// The counters of the calling thread, opened once per thread as one group so
+// that all events are read at the same instant. Events the CPU or the kernel
+// settings (perf_event_paranoid) don't allow read as zero.
+class perf_counters
+{
+  private:
+
+    int fds[PERF_EVENTS];
+
+    // position of each event in a group read, -1 if it didn't open
+    int slot[PERF_EVENTS];
+    int opened = 0;
+
+    static int open_event(uint32_t type, uint64_t config, int group)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+    }
+
+    perf_counters()
+    {
+        const uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D |
+                                       (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                       (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        const std::pair<uint32_t, uint64_t> events[PERF_EVENTS] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, l1d_read_miss},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        };
+
+        int leader = -1;
+        for (int e = 0; e < PERF_EVENTS; e++)
+        {
+            fds[e] = open_event(events[e].first, events[e].second, leader);
+            slot[e] = (fds[e] >= 0) ? opened++ : -1;
+            if (leader < 0)
+                leader = fds[e];
+        }
+    }
+
+  public:
+
+    perf_counters(perf_counters const&) = delete;
+    perf_counters& operator=(perf_counters const&) = delete;
+
+    ~perf_counters()
+    {
+        for (int fd : fds)
+        {
+            if (fd >= 0)
+                close(fd);
+        }
+    }
+
+    static perf_counters & local()
+    {
+        thread_local perf_counters counters;
+        return counters;
+    }
+
+    bool available() const { return opened > 0; }
+
+    perf_sample read() const
+    {
+        perf_sample s{};
+        if (not available())
+            return s;
+
+        // struct read_format with PERF_FORMAT_GROUP: the number of events,
+        // then one value per event in the order they were opened
+        uint64_t buf[1 + PERF_EVENTS];
+        int leader = -1;
+        for (int e = 0; e < PERF_EVENTS and leader < 0; e++)
+            leader = fds[e];
+        if (::read(leader, buf, sizeof(buf)) < (ssize_t)sizeof(uint64_t))
+            return s;
+
+        for (int e = 0; e < PERF_EVENTS; e++)
+        {
+            if (slot[e] >= 0 and (uint64_t)slot[e] < buf[0])
+                s[e] = buf[1 + slot[e]];
+        }
+        return s;
+    }
+};
+
+inline perf_sample read_perf_counters() { return perf_counters::local().read(); }
+
+// Adds the counts between construction and destruction to a region.
+class perf_scope
+{
+  private:
+
+    perf_profile & profile;
+    perf_region region;
+    perf_sample begin;
+
+  public:
+
+    perf_scope(perf_profile & _profile, perf_region _region)
+        : profile(_profile), region(_region), begin(read_perf_counters())
+    {
+    }
+
+    perf_scope(perf_scope const&) = delete;
+    perf_scope& operator=(perf_scope const&) = delete;
+
+    ~perf_scope() { profile.add(region, begin, read_perf_counters()); }
+};
+
+#define NARA_PERF_SCOPE(profile, region) ::nara::perf_scope nara_perf_scope((profile), ::nara::region)
+
+#else
+
+inline perf_sample read_perf_counters() { return perf_sample{}; }
+
+#define NARA_PERF_SCOPE(profile, region) static_cast<void>(0)
+
+#endif
+
+} // namespace nara
@@ -0,0 +1,117 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ai.hpp"
+#include "board.hpp"
+
+// Measures raw tree walking: every line gen_chooses allows is played to a
+// fixed depth with make/unmake only, so the leaf counts are exact and the
+// speed is that of move generation and incremental state updates. A second,
+// verifying pass compares the incremental states with get_state at every
+// node.
+//
+//     nara_perft [depth] [verify] [positions]
+//
+// The positions file has one position per line: 225 cells ('x' black,
+// 'o' white, '.' empty, row by row) and the side to move, 'x' or 'o'.
+// Without it a few built-in openings are used.
+
+struct perft_position
+{
+    nara::gomoku_board board;
+    nara::gomoku_chess next;
+};
+
+perft_position from_moves(std::vector<nara::point_t> const& moves)
+{
+    perft_position pos{nara::gomoku_board(), nara::BLACK};
+    for (auto p : moves)
+    {
+        pos.board.setchess(p, pos.next);
+        pos.next = nara::oppof(pos.next);
+    }
+    return pos;
+}
+
+bool parse_position(std::string const& line, perft_position & pos)
+{
+    std::stringstream ss(line);
+    std::string cells, side;
+    if (not (ss >> cells >> side) or cells.size() != 15 * 15 or (side != "x" and side != "o"))
+        return false;
+
+    for (int i = 0; i < 15 * 15; i++)
+    {
+        char c = cells[i];
+        pos.board.setchess(i / 15, i % 15, c == 'x' ? nara::BLACK : c == 'o' ? nara::WHITE : nara::EMPTY);
+    }
+    pos.next = (side == "x") ? nara::BLACK : nara::WHITE;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    int depth = (argc > 1) ? std::atoi(argv[1]) : 3;
+    bool verify = (argc > 2) ? std::atoi(argv[2]) != 0 : true;
+
+    std::vector<perft_position> positions;
+    if (argc > 3)
+    {
+        std::ifstream in(argv[3]);
+        if (not in)
+        {
+            std::cerr << "can't open " << argv[3] << std::endl;
+            return 1;
+        }
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (perft_position pos; parse_position(line, pos))
+                positions.push_back(pos);
+        }
+    }
+    else
+    {
+        positions.push_back(from_moves({{7, 7}}));
+        positions.push_back(from_moves({{7, 7}, {7, 8}, {8, 8}, {6, 6}}));
+        positions.push_back(from_moves({{7, 7}, {8, 8}, {7, 8}, {7, 6}, {6, 7}, {8, 7}}));
+        positions.push_back(from_moves({{7, 7}, {6, 8}, {8, 7}, {6, 7}, {6, 6}, {9, 8}, {8, 6}, {8, 8}}));
+    }
+
+    nara::gomoku_ai ai(nara::BLACK);
+
+    long total_nodes = 0;
+    double total_secs = 0;
+    long mismatches = 0;
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        auto const& pos = positions[i];
+
+        auto start = std::chrono::steady_clock::now();
+        auto res = ai.perft(pos.board, pos.next, depth, false);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        total_nodes += res.nodes;
+        total_secs += secs;
+
+        std::cout << "position " << i + 1 << ": " << res.leaves << " leaves, "
+                  << res.nodes << " nodes, " << res.nodes / std::max(secs, 1e-9) << " nodes/s";
+
+        if (verify)
+        {
+            auto checked = ai.perft(pos.board, pos.next, depth, true);
+            if (checked.leaves != res.leaves)
+                std::cout << ", leaf count differs when verifying";
+            std::cout << ", " << checked.mismatches << " state mismatches";
+            mismatches += checked.mismatches + (checked.leaves != res.leaves);
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "total: " << total_nodes << " nodes, " << total_nodes / std::max(total_secs, 1e-9) << " nodes/s" << std::endl;
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace nara
+{
+
+// A coroutine that runs one step per call to step(). Every co_yield ends a
+// step and publishes a value, co_return publishes the last one.
+template <typename T>
+class resumable
+{
+  public:
+
+    struct promise_type
+    {
+        std::optional<T> value;
+        std::exception_ptr error;
+
+        resumable get_return_object() { return resumable(handle_t::from_promise(*this)); }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        std::suspend_always yield_value(T v)
+        {
+            value = std::move(v);
+            return {};
+        }
+
+        void return_value(T v) { value = std::move(v); }
+
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+  private:
+
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    handle_t handle;
+
+    explicit resumable(handle_t _handle) : handle(_handle) {}
+
+  public:
+
+    resumable(resumable && other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+    resumable& operator=(resumable && other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle)
+                handle.destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~resumable()
+    {
+        if (handle)
+            handle.destroy();
+    }
+
+    // Runs to the next co_yield or to the end; false once finished.
+    bool step()
+    {
+        handle.resume();
+        if (handle.promise().error)
+            std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+        return not handle.done();
+    }
+
+    bool done() const { return handle.done(); }
+
+    // The last value published; valid after the first step.
+    T const& value() const { return *handle.promise().value; }
+};
+
+} // namespace nara
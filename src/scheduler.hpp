@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ai.hpp"
+#include "board.hpp"
+#include "config.hpp"
+#include "resumable.hpp"
+
+namespace nara
+{
+
+// Runs many searches, one per engine, on a fixed number of threads. Workers
+// take requests from a queue in turn, run one slice of `slice_nodes` nodes
+// of the request's search_steps coroutine and put it back at the end, so all
+// live requests get an equal share of the workers. A request past its
+// deadline is finished with the deepest iteration it has completed, or the
+// first generated move if it has none.
+class search_scheduler
+{
+  public:
+
+    using clock = std::chrono::steady_clock;
+    using result_t = gomoku_ai::search_res_t;
+
+  private:
+
+    struct request_t
+    {
+        resumable<result_t> steps;
+        clock::time_point deadline;
+        std::promise<result_t> result;
+    };
+
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::unique_ptr<request_t>> queue;
+    bool stopping = false;
+
+    long slice_nodes;
+
+    void work()
+    {
+        for (;;)
+        {
+            std::unique_ptr<request_t> req;
+            {
+                std::unique_lock lock(mutex);
+                wake.wait(lock, [&] { return stopping or not queue.empty(); });
+                if (stopping)
+                    return;
+                req = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            bool more;
+            try
+            {
+                more = req->steps.step();
+            }
+            catch (...)
+            {
+                req->result.set_exception(std::current_exception());
+                continue;
+            }
+
+            // before its first iteration a search publishes its first
+            // generated move, so a deadline is met even then
+            auto const& res = req->steps.value();
+            if (not more or clock::now() >= req->deadline)
+            {
+                req->result.set_value(res);
+                continue;
+            }
+
+            {
+                std::lock_guard lock(mutex);
+                queue.push_back(std::move(req));
+            }
+            wake.notify_one();
+        }
+    }
+
+  public:
+
+    explicit search_scheduler(int threads = std::thread::hardware_concurrency(), long _slice_nodes = 2000)
+        : slice_nodes(std::max(_slice_nodes, 1L))
+    {
+        for (int i = 0; i < std::max(threads, 1); i++)
+            workers.emplace_back(&search_scheduler::work, this);
+    }
+
+    search_scheduler(search_scheduler const&) = delete;
+    search_scheduler& operator=(search_scheduler const&) = delete;
+
+    // Requests still queued are abandoned: their futures report a broken
+    // promise, and their engines must outlive the scheduler.
+    ~search_scheduler()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto & w : workers)
+            w.join();
+    }
+
+    // Searches `board` with `ai`, which must stay alive and unused until the
+    // future is ready.
+    std::future<result_t> submit(gomoku_ai & ai, gomoku_board const& board, search_limits const& limits,
+                                 clock::time_point deadline = clock::time_point::max())
+    {
+        auto req = std::make_unique<request_t>(request_t{ai.search_steps(board, limits, slice_nodes), deadline, {}});
+        auto future = req->result.get_future();
+        {
+            std::lock_guard lock(mutex);
+            queue.push_back(std::move(req));
+        }
+        wake.notify_one();
+        return future;
+    }
+
+    size_t pending()
+    {
+        std::lock_guard lock(mutex);
+        return queue.size();
+    }
+};
+
+} // namespace nara
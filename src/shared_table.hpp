@@ -0,0 +1,290 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "board.hpp"
+#include "zobrist.hpp"
+
+namespace nara
+{
+
+// A table of proven results (the side to move wins or loses) that several
+// engine processes on one host can share. It lives in a POSIX shared memory
+// object (names like "/nara") or in a regular file, which keeps it across
+// runs. Entries are written without locks: `check` holds key ^ data, so a
+// torn or concurrent write simply fails verification and reads as a miss.
+
+struct shared_result_t
+{
+    bool win;
+    int depth;
+    point_t p;
+};
+
+class shared_result_table
+{
+  private:
+
+    struct header_t
+    {
+        char magic[8];
+        std::atomic<uint32_t> state;
+        uint32_t version;
+        uint64_t seed;
+        uint64_t capacity;
+    };
+
+    struct entry_t
+    {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+    static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+    enum : uint32_t
+    {
+        UNINITIALIZED,
+        INITIALIZING,
+        READY,
+    };
+
+    static constexpr char magic[8] = {'N', 'A', 'R', 'A', 'S', 'H', 'M', 'T'};
+    static constexpr uint32_t version = 1;
+    static constexpr int bucket_size = 4;
+
+    // data layout: move (8 bits, x * 15 + y), depth (8 bits), result (2 bits)
+    static constexpr uint64_t result_win = 1;
+    static constexpr uint64_t result_lose = 2;
+
+    header_t *header = nullptr;
+    entry_t *entries = nullptr;
+    size_t length = 0;
+    uint64_t mask = 0;
+
+    static uint64_t pack(shared_result_t const& r)
+    {
+        uint64_t move = r.p.x * 15 + r.p.y;
+        uint64_t depth = std::min(r.depth, 255);
+        uint64_t result = r.win ? result_win : result_lose;
+        return move | (depth << 8) | (result << 16);
+    }
+
+    static shared_result_t unpack(uint64_t data)
+    {
+        int move = data & 0xff;
+        return shared_result_t{((data >> 16) & 3) == result_win, int((data >> 8) & 0xff), {move / 15, move % 15}};
+    }
+
+    static int depth_of(uint64_t data) { return (data >> 8) & 0xff; }
+
+    static bool lock(int fd, int timeout_ms)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        while (flock(fd, LOCK_EX | LOCK_NB) < 0)
+        {
+            if (errno != EWOULDBLOCK or std::chrono::steady_clock::now() >= deadline)
+                return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+  public:
+
+    shared_result_table() = default;
+    shared_result_table(shared_result_table const&) = delete;
+    shared_result_table& operator=(shared_result_table const&) = delete;
+
+    ~shared_result_table() { close(); }
+
+    // `capacity` is rounded down to a power of two and only used when the
+    // table is created; an existing table keeps its own size. Openers take
+    // an flock on the object while they check or create it, so two first
+    // openers can't create it with different sizes, and a table left half
+    // created by a process that died (the lock goes with it) is created
+    // again. Fails if the lock isn't free within `lock_timeout_ms`.
+    bool open(std::string const& name, size_t capacity = 1 << 20, int lock_timeout_ms = 5000)
+    {
+        close();
+
+        size_t cap = bucket_size;
+        while (cap * 2 <= capacity)
+            cap *= 2;
+
+        bool is_shm = name.size() > 1 and name[0] == '/' and name.find('/', 1) == std::string::npos;
+        int fd = is_shm ? shm_open(name.c_str(), O_RDWR | O_CREAT, 0644)
+                        : ::open(name.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+            return false;
+
+        auto fail = [&]
+        {
+            close();
+            ::close(fd);
+            return false;
+        };
+
+        if (not lock(fd, lock_timeout_ms))
+            return fail();
+
+        struct stat st;
+        if (fstat(fd, &st) < 0)
+            return fail();
+
+        size_t size = st.st_size;
+        bool create = (size == 0);
+        if (create)
+        {
+            size = sizeof(header_t) + cap * sizeof(entry_t);
+            if (ftruncate(fd, size) < 0)
+                return fail();
+        }
+        else if (size < sizeof(header_t))
+            return fail();
+
+        void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+            return fail();
+        header = static_cast<header_t *>(p);
+        length = size;
+
+        if (not create and header->state.load() != READY)
+        {
+            // its creator died before finishing; start over at this size
+            if ((size - sizeof(header_t)) % sizeof(entry_t) != 0)
+                return fail();
+            std::memset(static_cast<void *>(header + 1), 0, size - sizeof(header_t));
+            create = true;
+        }
+
+        if (create)
+        {
+            header->state.store(INITIALIZING);
+            std::memcpy(header->magic, magic, sizeof(magic));
+            header->version = version;
+            header->seed = zobrist_seed;
+            header->capacity = (size - sizeof(header_t)) / sizeof(entry_t);
+            header->state.store(READY);
+        }
+
+        // unlocks too
+        ::close(fd);
+
+        if (std::memcmp(header->magic, magic, sizeof(magic)) != 0 or
+            header->version != version or
+            header->seed != zobrist_seed or
+            header->capacity < bucket_size or
+            sizeof(header_t) + header->capacity * sizeof(entry_t) != size or
+            (header->capacity & (header->capacity - 1)) != 0)
+        {
+            close();
+            return false;
+        }
+
+        entries = reinterpret_cast<entry_t *>(header + 1);
+        mask = header->capacity - 1;
+        return true;
+    }
+
+    void close()
+    {
+        if (header)
+        {
+            msync(header, length, MS_ASYNC);
+            munmap(header, length);
+        }
+        header = nullptr;
+        entries = nullptr;
+        length = 0;
+        mask = 0;
+    }
+
+    bool is_open() const { return header != nullptr; }
+
+    bool probe(uint64_t key, shared_result_t & res) const
+    {
+        auto bucket = entries + (key & mask & ~uint64_t(bucket_size - 1));
+        for (int i = 0; i < bucket_size; i++)
+        {
+            uint64_t data = bucket[i].data.load(std::memory_order_relaxed);
+            uint64_t check = bucket[i].check.load(std::memory_order_relaxed);
+            if (data != 0 and (check ^ data) == key)
+            {
+                res = unpack(data);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Replaces the same key, else an empty slot, else the shallowest entry.
+    void store(uint64_t key, shared_result_t const& res)
+    {
+        auto bucket = entries + (key & mask & ~uint64_t(bucket_size - 1));
+        int victim = 0;
+        int victim_depth = 256;
+        for (int i = 0; i < bucket_size; i++)
+        {
+            uint64_t data = bucket[i].data.load(std::memory_order_relaxed);
+            uint64_t check = bucket[i].check.load(std::memory_order_relaxed);
+            if (data == 0 or (check ^ data) == key)
+            {
+                victim = i;
+                break;
+            }
+            if (depth_of(data) < victim_depth)
+            {
+                victim = i;
+                victim_depth = depth_of(data);
+            }
+        }
+
+        uint64_t data = pack(res);
+        bucket[victim].check.store(key ^ data, std::memory_order_relaxed);
+        bucket[victim].data.store(data, std::memory_order_relaxed);
+    }
+
+    // Copies the table to a regular file, e.g. to keep a shm table between runs.
+    bool save(std::string const& path) const
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (not out)
+            return false;
+        out.write(reinterpret_cast<const char *>(header), length);
+        return bool(out);
+    }
+
+    // Merges the entries of a table previously written by `save`.
+    bool load(std::string const& path)
+    {
+        shared_result_table other;
+        if (access(path.c_str(), R_OK) != 0 or not other.open(path))
+            return false;
+        for (size_t i = 0; i <= other.mask; i++)
+        {
+            uint64_t data = other.entries[i].data.load(std::memory_order_relaxed);
+            uint64_t check = other.entries[i].check.load(std::memory_order_relaxed);
+            if (data != 0)
+                store(check ^ data, unpack(data));
+        }
+        return true;
+    }
+};
+
+} // namespace nara
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+namespace nara
+{
+
+// A gomoku_ai saved to a flat blob, see gomoku_ai::snapshot: a
+// snapshot_header, the board (one byte per cell, x * 15 + y), then
+// `tt_count` transposition table entries. The states and keys are rebuilt
+// from the board on restore. Table entries are keyed by zobrist keys, so a
+// blob only restores into a build with the same zobrist seed.
+
+struct snapshot_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t tt_count;
+    uint64_t seed;
+    uint8_t mine;
+    uint8_t pad[7];
+};
+
+struct snapshot_tt_entry
+{
+    uint64_t key;
+    int32_t score;
+    int8_t depth;
+    uint8_t bound;
+
+    // x * 15 + y, in the canonical orientation like the table's
+    uint8_t move;
+    uint8_t pad;
+};
+
+static_assert(sizeof(snapshot_header) == 32);
+static_assert(sizeof(snapshot_tt_entry) == 16);
+
+const char snapshot_magic[8] = {'N', 'A', 'R', 'A', 'S', 'N', 'A', 'P'};
+const uint32_t snapshot_version = 2;
+
+namespace detail
+{
+
+// Appends the bytes of `v`.
+template <typename T>
+void put_raw(std::vector<uint8_t> & out, T const& v)
+{
+    auto p = reinterpret_cast<const uint8_t *>(&v);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+// Copies the next sizeof(T) bytes of `in` into `v`; false past the end.
+template <typename T>
+bool get_raw(std::span<const uint8_t> & in, T & v)
+{
+    if (in.size() < sizeof(T))
+        return false;
+    std::memcpy(&v, in.data(), sizeof(T));
+    in = in.subspan(sizeof(T));
+    return true;
+}
+
+} // namespace detail
+
+} // namespace nara
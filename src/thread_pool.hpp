@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace nara
+{
+
+// A fixed set of workers that run parallel loops. A loop hands out indexes
+// one at a time, so uneven tasks such as root moves balance themselves, and
+// it allocates nothing per call.
+class thread_pool
+{
+  private:
+
+    std::vector<std::thread> workers;
+
+    // serializes callers, one loop runs at a time
+    std::mutex loop_mutex;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+
+    // the current loop
+    void *ctx = nullptr;
+    void (*call)(void *, int, size_t) = nullptr;
+    size_t count = 0;
+    std::atomic<size_t> next_index = 0;
+
+    unsigned generation = 0;
+    int running = 0;
+    bool stopping = false;
+
+    void work(int id)
+    {
+        unsigned seen = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock lock(mutex);
+                wake.wait(lock, [&] { return stopping or generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+            }
+
+            for (size_t i = next_index++; i < count; i = next_index++)
+                call(ctx, id, i);
+
+            std::lock_guard lock(mutex);
+            if (--running == 0)
+                finished.notify_all();
+        }
+    }
+
+  public:
+
+    explicit thread_pool(int threads = std::thread::hardware_concurrency())
+    {
+        for (int i = 0; i < std::max(threads, 1); i++)
+            workers.emplace_back(&thread_pool::work, this, i);
+    }
+
+    thread_pool(thread_pool const&) = delete;
+    thread_pool& operator=(thread_pool const&) = delete;
+
+    ~thread_pool()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto & w : workers)
+            w.join();
+    }
+
+    int size() const { return workers.size(); }
+
+    // Calls func(worker, i) for every i in [0, n) and waits for all of them.
+    // `worker` is in [0, size()), so callers can keep per-worker state.
+    template <typename F>
+    void parallel_for(size_t n, F&& func)
+    {
+        std::lock_guard loop_lock(loop_mutex);
+        std::unique_lock lock(mutex);
+        ctx = const_cast<void *>(static_cast<const void *>(&func));
+        call = [](void *f, int worker, size_t i) { (*static_cast<std::remove_reference_t<F> *>(f))(worker, i); };
+        count = n;
+        next_index = 0;
+        running = workers.size();
+        generation++;
+        wake.notify_all();
+        finished.wait(lock, [&] { return running == 0; });
+    }
+};
+
+} // namespace nara
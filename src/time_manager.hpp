@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+
+#include "board.hpp"
+
+namespace nara
+{
+
+// Decides when an iterative deepening search with a time budget stops. The
+// budget is a target; after every iteration the soft limit is set to the
+// target scaled by how settled the search looks: longer while the best move
+// keeps changing or the score is falling, shorter once the best move has
+// held for a few iterations. An iteration only starts if it is expected to
+// end within the soft limit, and the hard limit cuts one short.
+
+enum time_stop
+{
+    STOP_NONE,
+    STOP_DEPTH,
+    STOP_FORCED,
+    STOP_PROVEN,
+    STOP_SOFT,
+    STOP_HARD,
+    STOP_NODES,
+    STOP_CANCEL,
+};
+
+inline const char *const time_stop_names[] = {
+    "running", "max depth", "forced move", "proven result", "soft limit", "hard limit", "node limit",
+    "cancelled"};
+
+struct time_report
+{
+    // the budget, and the soft limit it was scaled to
+    long target_ms = 0;
+    long allocated_ms = 0;
+    long used_ms = 0;
+    int iterations = 0;
+    int best_changes = 0;
+    time_stop reason = STOP_NONE;
+};
+
+class time_manager
+{
+  public:
+
+    using clock = std::chrono::steady_clock;
+
+  private:
+
+    clock::time_point start_time;
+    double target = 0;
+    double soft = 0;
+    double hard = 0;
+    bool adaptive = true;
+
+    double last_elapsed = 0;
+    double last_took = 0;
+
+    point_t last_best{-1, -1};
+    int last_score = 0;
+
+    // best move changes, halved every iteration
+    double instability = 0;
+
+    // iterations since the best move last changed
+    int stable = 0;
+
+    time_report rep;
+
+  public:
+
+    // `move_ms` 0 turns time management off; `max_ms` 0 allows three times
+    // the target.
+    void start(long move_ms, long max_ms, bool _adaptive)
+    {
+        start_time = clock::now();
+        target = soft = move_ms;
+        hard = move_ms ? (max_ms ? max_ms : 3 * move_ms) : 0;
+        adaptive = _adaptive;
+        last_elapsed = last_took = 0;
+        last_best = {-1, -1};
+        last_score = 0;
+        instability = 0;
+        stable = 0;
+        rep = time_report{};
+        rep.target_ms = move_ms;
+        rep.allocated_ms = move_ms;
+    }
+
+    bool enabled() const { return target > 0; }
+
+    double elapsed_ms() const
+    {
+        return std::chrono::duration<double, std::milli>(clock::now() - start_time).count();
+    }
+
+    bool hard_expired() const { return enabled() and elapsed_ms() >= hard; }
+
+    // Called after every completed iteration with its result and the number
+    // of moves at the root; false when the next one shouldn't start.
+    bool next_iteration(point_t best, int score, int root_moves)
+    {
+        double elapsed = elapsed_ms();
+        double took = elapsed - last_elapsed;
+        rep.iterations++;
+
+        if (rep.iterations > 1)
+        {
+            bool changed = not (best == last_best);
+            rep.best_changes += changed;
+            instability = instability / 2 + changed;
+            stable = changed ? 0 : stable + 1;
+        }
+
+        int drop = (rep.iterations > 1) ? last_score - score : 0;
+        last_best = best;
+        last_score = score;
+
+        if (not enabled())
+            return true;
+
+        if (root_moves == 1)
+        {
+            stop(STOP_FORCED);
+            return false;
+        }
+
+        if (adaptive)
+        {
+            double factor = 1 + instability;
+            if (drop > 30)
+                factor *= (drop > 100) ? 2 : 1.5;
+            if (stable >= 3)
+                factor *= 0.6;
+            soft = std::min(target * factor, hard);
+            rep.allocated_ms = soft;
+        }
+
+        // the next iteration takes a few times as long as this one, as
+        // much as the last growth suggests
+        double growth = (last_took > 0) ? std::clamp(took / last_took, 2.0, 6.0) : 2.0;
+        last_elapsed = elapsed;
+        last_took = took;
+
+        if (elapsed + took * growth > soft)
+        {
+            stop(STOP_SOFT);
+            return false;
+        }
+        return true;
+    }
+
+    // Records why the search ended; the first reason given is kept.
+    void stop(time_stop reason)
+    {
+        if (rep.reason == STOP_NONE)
+            rep.reason = reason;
+    }
+
+    void finish()
+    {
+        stop(STOP_DEPTH);
+        rep.used_ms = elapsed_ms();
+    }
+
+    time_report const& report() const { return rep; }
+};
+
+} // namespace nara
@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ai.hpp"
+#include "archive.hpp"
+#include "board.hpp"
+#include "tree_log.hpp"
+
+// Records and inspects the tree alphabeta searches.
+//
+//     nara_tree record <log> [depth] [moves] [capacity]
+//     nara_tree summary <log>
+//     nara_tree dot <log> <node id> [plies]
+//
+// record searches the position reached by a move list ("h8 i9 ...", see
+// archive.hpp) with iterative deepening and writes the last `capacity`
+// nodes. summary prints, per ply, how many moves were generated and
+// searched, how often the first move cut and where the nodes of the last
+// root went. dot writes the subtree under a node as a Graphviz graph.
+
+std::string move_name(uint8_t move)
+{
+    if (move == nara::tree_no_move)
+        return "-";
+    std::string s(1, 'a' + move % 15);
+    s += std::to_string(15 - move / 15);
+    return s;
+}
+
+std::string flag_names(uint8_t flags)
+{
+    std::string s;
+    const std::pair<uint8_t, const char *> names[] = {
+        {nara::TREE_TT_HIT, " tt"}, {nara::TREE_SHARED_HIT, " shared"}, {nara::TREE_LEAF, " leaf"},
+        {nara::TREE_NULL, " null"}, {nara::TREE_VERIFY, " singular"}, {nara::TREE_NULL_CUT, " null-cut"},
+        {nara::TREE_STOPPED, " stopped"}};
+    for (auto [f, name] : names)
+    {
+        if (flags & f)
+            s += name;
+    }
+    return s;
+}
+
+int record(std::string const& path, int depth, std::string const& moves, size_t capacity)
+{
+    nara::gomoku_board board;
+    nara::gomoku_chess next = nara::BLACK;
+    if (nara::text_game game; not moves.empty())
+    {
+        if (not nara::parse_move_list(moves, game))
+        {
+            std::cerr << "bad move list: " << moves << std::endl;
+            return 1;
+        }
+        for (uint8_t m : game.moves)
+        {
+            board.setchess(m / 15, m % 15, next);
+            next = nara::oppof(next);
+        }
+    }
+
+    nara::tree_recorder recorder(capacity);
+    nara::gomoku_ai ai(next);
+    ai.set_recorder(&recorder);
+
+    nara::search_limits limits;
+    limits.max_depth = depth;
+    auto res = ai.search(board, limits);
+
+    std::cout << "best " << res.p << " score " << res.score << " depth " << res.depth << ", "
+              << recorder.total() << " nodes, " << recorder.size() << " kept" << std::endl;
+
+    if (not recorder.write(path))
+    {
+        std::cerr << "failed to write " << path << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+struct ply_stat
+{
+    long nodes = 0;
+    long leaves = 0;
+    long hits = 0;
+    long expanded = 0;
+    long generated = 0;
+    long searched = 0;
+    long cutoffs = 0;
+    long first_cutoffs = 0;
+    long cutoff_index_sum = 0;
+};
+
+int summary(nara::tree_log_header const& header, std::vector<nara::tree_node_record> const& records)
+{
+    std::cout << header.total << " nodes recorded, " << records.size() << " kept" << std::endl;
+
+    std::map<int, ply_stat> plies;
+    for (auto const& r : records)
+    {
+        auto & s = plies[r.ply];
+        s.nodes++;
+        s.leaves += (r.flags & nara::TREE_LEAF) != 0;
+        s.hits += (r.flags & (nara::TREE_TT_HIT | nara::TREE_SHARED_HIT)) != 0;
+        if (r.moves)
+        {
+            s.expanded++;
+            s.generated += r.moves;
+            s.searched += r.searched;
+        }
+        if (r.cutoff != nara::tree_no_cutoff)
+        {
+            s.cutoffs++;
+            s.first_cutoffs += (r.cutoff == 0);
+            s.cutoff_index_sum += r.cutoff;
+        }
+    }
+
+    // branching is the moves searched per expanded node; a well ordered
+    // search cuts on the first move most of the time
+    std::cout << "ply  nodes  leaves  hits  generated  searched  cutoffs  first-cut  mean-cut-index" << std::endl;
+    for (auto const& [ply, s] : plies)
+    {
+        auto avg = [](long sum, long n) { return n ? (double)sum / n : 0.0; };
+        std::cout << ply << "  " << s.nodes << "  " << s.leaves << "  " << s.hits << "  "
+                  << avg(s.generated, s.expanded) << "  " << avg(s.searched, s.expanded) << "  "
+                  << s.cutoffs << "  " << 100 * avg(s.first_cutoffs, s.cutoffs) << "%  "
+                  << avg(s.cutoff_index_sum, s.cutoffs) << std::endl;
+    }
+
+    // children are written before their parents, so subtree sizes add up
+    // in one pass
+    std::unordered_map<uint32_t, long> subtree;
+    const nara::tree_node_record *root = nullptr;
+    for (auto const& r : records)
+    {
+        subtree[r.id]++;
+        if (r.parent == nara::tree_no_parent)
+            root = &r;
+        else
+            subtree[r.parent] += subtree[r.id];
+    }
+    if (not root)
+        return 0;
+
+    std::vector<nara::tree_node_record const *> children;
+    for (auto const& r : records)
+    {
+        if (r.parent == root->id)
+            children.push_back(&r);
+    }
+    std::ranges::sort(children, [&](auto a, auto b) { return subtree[a->id] > subtree[b->id]; });
+
+    std::cout << "last root: node " << root->id << ", depth " << (int)root->depth << ", score " << root->score
+              << ", " << subtree[root->id] << " nodes" << std::endl;
+    for (auto c : children)
+    {
+        std::cout << "  " << move_name(c->move) << " node " << c->id << ": " << subtree[c->id] << " nodes, score "
+                  << c->score << flag_names(c->flags) << std::endl;
+    }
+    return 0;
+}
+
+int dot(std::vector<nara::tree_node_record> const& records, uint32_t id, int max_plies)
+{
+    std::unordered_map<uint32_t, nara::tree_node_record const *> by_id;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> children;
+    for (auto const& r : records)
+    {
+        by_id[r.id] = &r;
+        if (r.parent != nara::tree_no_parent)
+            children[r.parent].push_back(r.id);
+    }
+
+    if (not by_id.contains(id))
+    {
+        std::cerr << "node " << id << " isn't in the log" << std::endl;
+        return 1;
+    }
+
+    std::cout << "digraph tree {" << std::endl << "    node [shape=box, fontsize=10];" << std::endl;
+
+    std::vector<std::pair<uint32_t, int>> stack{{id, 0}};
+    while (not stack.empty())
+    {
+        auto [n, plies] = stack.back();
+        stack.pop_back();
+
+        auto const& r = *by_id[n];
+        std::cout << "    n" << r.id << " [label=\"" << move_name(r.move) << " d" << (int)r.depth
+                  << "\\n[" << r.alpha << ", " << r.beta << "] " << r.score
+                  << "\\n" << (int)r.searched << "/" << (int)r.moves << flag_names(r.flags) << "\"";
+        if (r.cutoff != nara::tree_no_cutoff)
+            std::cout << ", color=red";
+        std::cout << "];" << std::endl;
+
+        if (plies == max_plies)
+            continue;
+        for (auto c : children[n])
+        {
+            std::cout << "    n" << n << " -> n" << c << ";" << std::endl;
+            stack.push_back({c, plies + 1});
+        }
+    }
+    std::cout << "}" << std::endl;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string command = (argc > 1) ? argv[1] : "";
+    if (argc < 3 or (command != "record" and command != "summary" and command != "dot") or
+        (command == "dot" and argc < 4))
+    {
+        std::cerr << "usage: " << argv[0] << " record <log> [depth] [moves] [capacity]" << std::endl
+                  << "       " << argv[0] << " summary <log>" << std::endl
+                  << "       " << argv[0] << " dot <log> <node id> [plies]" << std::endl;
+        return 1;
+    }
+
+    if (command == "record")
+    {
+        int depth = (argc > 3) ? std::atoi(argv[3]) : 6;
+        std::string moves = (argc > 4) ? argv[4] : "";
+        size_t capacity = (argc > 5) ? std::atol(argv[5]) : 1 << 20;
+        return record(argv[2], depth, moves, capacity);
+    }
+
+    nara::tree_log_header header;
+    std::vector<nara::tree_node_record> records;
+    if (not nara::read_tree_log(argv[2], header, records))
+    {
+        std::cerr << "can't read " << argv[2] << std::endl;
+        return 1;
+    }
+
+    if (command == "summary")
+        return summary(header, records);
+    return dot(records, std::atol(argv[3]), (argc > 4) ? std::atoi(argv[4]) : 2);
+}
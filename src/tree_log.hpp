@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "board.hpp"
+
+namespace nara
+{
+
+// A record of the nodes alphabeta visits, for finding where a search spends
+// its nodes. Nodes get increasing ids on entry and are written when they
+// return, children before their parents, into a ring that keeps the last
+// `capacity` of them. On disk: a tree_log_header, then the kept records
+// oldest first.
+
+enum tree_flag : uint8_t
+{
+    TREE_MAX = 1,
+
+    // returned from the transposition or shared table
+    TREE_TT_HIT = 2,
+    TREE_SHARED_HIT = 4,
+
+    // evaluated as a leaf (depth 0)
+    TREE_LEAF = 8,
+
+    // in the subtree of a null move or of a singular test
+    TREE_NULL = 16,
+    TREE_VERIFY = 32,
+
+    TREE_NULL_CUT = 64,
+    TREE_STOPPED = 128,
+};
+
+struct tree_node_record
+{
+    uint32_t id;
+
+    // tree_no_parent for a root
+    uint32_t parent;
+
+    int32_t alpha;
+    int32_t beta;
+    int32_t score;
+
+    // x * 15 + y of the move into the node, tree_no_move for a root or a
+    // null move
+    uint8_t move;
+    uint8_t ply;
+    int8_t depth;
+    uint8_t flags;
+
+    // moves generated, moves searched, and the index of the move that
+    // failed high (tree_no_cutoff if none)
+    uint8_t moves;
+    uint8_t searched;
+    uint8_t cutoff;
+    uint8_t pad;
+};
+
+struct tree_log_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint64_t total;
+};
+
+static_assert(sizeof(tree_node_record) == 28);
+static_assert(sizeof(tree_log_header) == 24);
+
+const char tree_log_magic[8] = {'N', 'A', 'R', 'A', 'T', 'R', 'E', 'E'};
+const uint32_t tree_log_version = 1;
+
+const uint32_t tree_no_parent = 0xffffffff;
+const uint8_t tree_no_move = 0xff;
+const uint8_t tree_no_cutoff = 0xff;
+
+class tree_recorder
+{
+  private:
+
+    std::vector<tree_node_record> ring;
+    uint64_t written = 0;
+    uint32_t next_id = 0;
+
+    // nodes entered and not yet returned, the innermost last
+    std::vector<tree_node_record> open;
+
+  public:
+
+    explicit tree_recorder(size_t capacity = 1 << 20) : ring(std::max<size_t>(capacity, 1))
+    {
+        open.reserve(256);
+    }
+
+    void clear()
+    {
+        written = 0;
+        next_id = 0;
+        open.clear();
+    }
+
+    void enter(point_t move, int depth, int alpha, int beta, bool ismax, uint8_t flags)
+    {
+        tree_node_record r{};
+        r.id = next_id++;
+        r.parent = open.empty() ? tree_no_parent : open.back().id;
+        r.alpha = alpha;
+        r.beta = beta;
+
+        // a null move passes on the move of the node it was tried at
+        bool null_move = (flags & TREE_NULL) and not open.empty() and not (open.back().flags & TREE_NULL);
+        r.move = (open.empty() or null_move) ? tree_no_move : move.x * 15 + move.y;
+        r.ply = std::min<size_t>(open.size(), 255);
+        r.depth = std::clamp(depth, -128, 127);
+        r.flags = flags | (ismax ? TREE_MAX : 0);
+        r.cutoff = tree_no_cutoff;
+        open.push_back(r);
+    }
+
+    // The innermost open node, for alphabeta to fill in as it goes.
+    tree_node_record & current() { return open.back(); }
+
+    void leave(int score, bool stopped)
+    {
+        auto r = open.back();
+        open.pop_back();
+        r.score = score;
+        if (stopped)
+            r.flags |= TREE_STOPPED;
+        ring[written++ % ring.size()] = r;
+    }
+
+    size_t size() const { return std::min<uint64_t>(written, ring.size()); }
+
+    uint64_t total() const { return written; }
+
+    // The kept records, oldest first.
+    std::vector<tree_node_record> records() const
+    {
+        std::vector<tree_node_record> out;
+        out.reserve(size());
+        for (uint64_t i = written - size(); i < written; i++)
+            out.push_back(ring[i % ring.size()]);
+        return out;
+    }
+
+    bool write(std::string const& path) const
+    {
+        auto recs = records();
+
+        tree_log_header header;
+        std::memcpy(header.magic, tree_log_magic, sizeof(tree_log_magic));
+        header.version = tree_log_version;
+        header.count = recs.size();
+        header.total = written;
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (not out)
+            return false;
+
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(recs.data()), recs.size() * sizeof(tree_node_record));
+        return bool(out);
+    }
+};
+
+inline bool read_tree_log(std::string const& path, tree_log_header & header, std::vector<tree_node_record> & records)
+{
+    std::ifstream in(path, std::ios::binary);
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (not in or std::memcmp(header.magic, tree_log_magic, sizeof(tree_log_magic)) != 0 or
+        header.version != tree_log_version)
+        return false;
+
+    records.resize(header.count);
+    in.read(reinterpret_cast<char *>(records.data()), records.size() * sizeof(tree_node_record));
+    return bool(in);
+}
+
+} // namespace nara
@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "archive.hpp"
+#include "board.hpp"
+#include "dataset.hpp"
+#include "eval.hpp"
+#include "eval_weights.hpp"
+#include "log.hpp"
+
+// Tunes eval_weights::rank on labelled positions (Texel's method): the static
+// eval of a position, passed through a logistic, should predict the game
+// result. Since the eval is linear in the rank weights, each position is
+// reduced once to its window counts and the descent only touches those.
+//
+//     nara_tune <positions> [output] [iterations] [threads]
+//
+// The positions are either a dataset written by nara_datagen, a game archive
+// (every position of every game, labelled with the game's result) or a text
+// file where each line is 225 cells ('x' black, 'o' white, '.' empty, row by
+// row) and the result for black: 1, 0.5 or 0. The tuned weights are written as a
+// replacement for eval_weights.hpp.
+
+// Black's counts minus white's, with the result; 16 bytes per position so the
+// store streams through the cache.
+struct tune_position
+{
+    int16_t features[5];
+    int16_t pad;
+    float result;
+};
+
+static_assert(sizeof(tune_position) == 16);
+
+bool parse_position(std::string const& line, nara::gomoku_board & board, float & result)
+{
+    std::stringstream ss(line);
+    std::string cells;
+    if (not (ss >> cells >> result) or cells.size() != 15 * 15)
+        return false;
+
+    for (int i = 0; i < 15 * 15; i++)
+    {
+        char c = cells[i];
+        board.setchess(i / 15, i % 15, c == 'x' ? nara::BLACK : c == 'o' ? nara::WHITE : nara::EMPTY);
+    }
+    return true;
+}
+
+template <typename F>
+void parallel_for(size_t n, int threads, F&& func)
+{
+    std::vector<std::thread> workers;
+    size_t chunk = (n + threads - 1) / threads;
+    for (int t = 0; t < threads; t++)
+    {
+        size_t begin = t * chunk;
+        size_t end = std::min(n, begin + chunk);
+        workers.emplace_back([&func, t, begin, end] { func(t, begin, end); });
+    }
+    for (auto & w : workers)
+        w.join();
+}
+
+double sigmoid(double k, double eval) { return 1.0 / (1.0 + std::exp(-k * eval)); }
+
+double eval_of(tune_position const& p, std::array<double, 5> const& w)
+{
+    double e = 0;
+    for (int i = 0; i < 5; i++)
+        e += w[i] * p.features[i];
+    return e;
+}
+
+double total_error(std::vector<tune_position> const& positions, std::array<double, 5> const& w, double k, int threads)
+{
+    std::vector<double> errors(threads);
+    parallel_for(positions.size(), threads, [&](int t, size_t begin, size_t end)
+    {
+        double sum = 0;
+        for (size_t i = begin; i < end; i++)
+        {
+            double d = positions[i].result - sigmoid(k, eval_of(positions[i], w));
+            sum += d * d;
+        }
+        errors[t] = sum;
+    });
+    double sum = 0;
+    for (double e : errors)
+        sum += e;
+    return sum / positions.size();
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <positions> [output] [iterations] [threads]" << std::endl;
+        return 1;
+    }
+
+    std::string output = (argc > 2) ? argv[2] : "eval_weights.hpp";
+    int iterations = (argc > 3) ? std::atoi(argv[3]) : 500;
+    int threads = std::max(1, (argc > 4) ? std::atoi(argv[4]) : int(std::thread::hardware_concurrency()));
+
+    nara::dataset_reader dataset;
+    bool is_dataset = dataset.open(argv[1]);
+
+    nara::archive_reader archive;
+    bool is_archive = not is_dataset and archive.open(argv[1]);
+    uint64_t archive_offset = archive.begin();
+    nara::archive_game game;
+    size_t ply = 0;
+    nara::gomoku_board replayed;
+
+    std::ifstream in;
+    if (not is_dataset and not is_archive)
+    {
+        in.open(argv[1]);
+        if (not in)
+        {
+            std::cerr << "can't open " << argv[1] << std::endl;
+            return 1;
+        }
+    }
+
+    // Positions are read in batches; feature extraction is the expensive
+    // part, so each batch is reduced on all threads.
+    const size_t batch_size = 1 << 16;
+    std::vector<nara::gomoku_board> boards(batch_size);
+    std::vector<float> results(batch_size);
+    std::vector<tune_position> positions;
+
+    for (;;)
+    {
+        size_t n = 0;
+        while (n < batch_size)
+        {
+            if (is_dataset)
+            {
+                nara::dataset_record r;
+                if (not dataset.next(r))
+                    break;
+                boards[n] = r.board;
+                results[n] = (r.result == nara::RESULT_BLACK) ? 1.0f : (r.result == nara::RESULT_WHITE) ? 0.0f : 0.5f;
+                n++;
+            }
+            else if (is_archive)
+            {
+                if (ply == game.moves.size())
+                {
+                    if (not archive.read_at(archive_offset, game))
+                        break;
+                    replayed = nara::gomoku_board();
+                    ply = 0;
+                    continue;
+                }
+                replayed.setchess(game.move(ply), game.player(ply));
+                ply++;
+                boards[n] = replayed;
+                results[n] = (game.result == nara::RESULT_BLACK) ? 1.0f : (game.result == nara::RESULT_WHITE) ? 0.0f : 0.5f;
+                n++;
+            }
+            else
+            {
+                std::string line;
+                if (not std::getline(in, line))
+                    break;
+                if (parse_position(line, boards[n], results[n]))
+                    n++;
+            }
+        }
+        if (n == 0)
+            break;
+
+        size_t base = positions.size();
+        positions.resize(base + n);
+        parallel_for(n, threads, [&](int, size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                auto blk = nara::rank_counts(boards[i], nara::BLACK);
+                auto wht = nara::rank_counts(boards[i], nara::WHITE);
+                auto & p = positions[base + i];
+                for (int f = 0; f < 5; f++)
+                    p.features[f] = std::clamp(blk[f] - wht[f], -32768, 32767);
+                p.result = results[i];
+            }
+        });
+    }
+
+    if (positions.empty())
+    {
+        std::cerr << "no positions" << std::endl;
+        return 1;
+    }
+    std::cout << positions.size() << " positions" << std::endl;
+
+    std::array<double, 5> w;
+    for (int i = 0; i < 5; i++)
+        w[i] = nara::default_eval_weights.rank[i];
+
+    // scale of the logistic, fitted to the current weights and then fixed
+    double k = 0.001;
+    double best = total_error(positions, w, k, threads);
+    for (double step = 0.01; step > 1e-6; step /= 10)
+    {
+        for (;;)
+        {
+            double e_up = total_error(positions, w, k + step, threads);
+            double e_down = (k > step) ? total_error(positions, w, k - step, threads) : best;
+            if (e_up < best)
+                k += step, best = e_up;
+            else if (e_down < best)
+                k -= step, best = e_down;
+            else
+                break;
+        }
+    }
+    std::cout << "k = " << k << ", error " << best << std::endl;
+
+    // Adam over the mean squared error
+    std::array<double, 5> m{}, v{};
+    const double rate = 0.1, beta1 = 0.9, beta2 = 0.999;
+    for (int it = 1; it <= iterations; it++)
+    {
+        std::vector<std::array<double, 5>> grads(threads);
+        parallel_for(positions.size(), threads, [&](int t, size_t begin, size_t end)
+        {
+            std::array<double, 5> g{};
+            for (size_t i = begin; i < end; i++)
+            {
+                auto & p = positions[i];
+                double s = sigmoid(k, eval_of(p, w));
+                double d = -2.0 * (p.result - s) * s * (1 - s) * k;
+                for (int f = 0; f < 5; f++)
+                    g[f] += d * p.features[f];
+            }
+            grads[t] = g;
+        });
+
+        for (int f = 0; f < 5; f++)
+        {
+            double g = 0;
+            for (auto & part : grads)
+                g += part[f];
+            g /= positions.size();
+
+            m[f] = beta1 * m[f] + (1 - beta1) * g;
+            v[f] = beta2 * v[f] + (1 - beta2) * g * g;
+            double mh = m[f] / (1 - std::pow(beta1, it));
+            double vh = v[f] / (1 - std::pow(beta2, it));
+            w[f] -= rate * mh / (std::sqrt(vh) + 1e-8);
+        }
+
+        if (it % 50 == 0 or it == iterations)
+            std::cout << "iteration " << it << ", error " << total_error(positions, w, k, threads) << std::endl;
+    }
+
+    std::ofstream out(output);
+    out << "#pragma once\n\n"
+        << "// Pattern weights used by cal_rank. This file can be regenerated by\n"
+        << "// nara_tune from labelled positions.\n\n"
+        << "#include <array>\n\n"
+        << "namespace nara\n{\n\n"
+        << "struct eval_weights\n{\n"
+        << "    // score of an open five-cell window through a stone, indexed by how many\n"
+        << "    // other cells of the window hold own stones\n"
+        << "    std::array<int, 5> rank;\n"
+        << "};\n\n"
+        << "constexpr eval_weights default_eval_weights = {{";
+    for (int f = 0; f < 5; f++)
+        out << (f ? ", " : "") << std::lround(w[f]);
+    out << "}};\n\n} // namespace nara\n";
+
+    std::cout << "wrote " << output << std::endl;
+    return 0;
+}
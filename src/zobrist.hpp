@@ -1,9 +1,10 @@
 #pragma once
 
 #include <array>
-#include <random>
 #include <limits>
 #include <cstddef>
+#include <cstdint>
+#include <utility>
 
 #include "board.hpp"
 
@@ -12,55 +13,123 @@ namespace nara
 
 using zobrist_t = std::array<std::array<size_t, 15>, 15>;
 
-struct zobrist_hash
-{
-    size_t operator() (const zobrist_t zob) const
-    {
-        size_t h = 0;
-        for (size_t i = 0; i < 15; i++)
-            for (size_t j = 0; j < 15; j++)
-                if (zob[i][j]) h ^= zob[i][j];
-        return h;
-    }
-};
+// Keys are generated at compile time from a fixed seed, so they are the same
+// in every run and every engine, which the on-disk opening book and the
+// shared result table rely on.
+constexpr uint64_t zobrist_seed = 0x6e617261676f6d6bULL;
+
+// Xored into the keys while the side to move differs from the one implied by
+// the stones on the board, i.e. below a null move.
+constexpr uint64_t zobrist_side = 0x9d39247e33776d41ULL;
 
-struct zobrist_eq
+constexpr uint64_t splitmix64(uint64_t & state)
 {
-    bool operator() (const zobrist_t z1, const zobrist_t z2) const
-    {
-        for (size_t i = 0; i < 15; i++)
-            for (size_t j = 0; j < 15; j++)
-                if (z1[i][j] != z2[i][j]) return false;
-        return true;
-    }
-};
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
 
+struct zobrist_tables
+{
+    zobrist_t blk{};
+    zobrist_t wht{};
 
-zobrist_t zob_blk;
-zobrist_t zob_wht;
+    // sym_*[sym][x][y] is the key of a stone at {x, y} once the board is
+    // seen through the symmetry `sym`, see `transform`.
+    std::array<zobrist_t, 8> sym_blk{};
+    std::array<zobrist_t, 8> sym_wht{};
+};
 
-void init_zobrist()
+constexpr zobrist_tables gen_zobrist_tables()
 {
-    std::random_device rd;
-    std::mt19937_64 gen(rd());
-    std::uniform_int_distribution<unsigned long> dist(1, std::numeric_limits<unsigned long>::max());
+    zobrist_tables t;
+    uint64_t state = zobrist_seed;
 
     for (size_t i = 0; i < 15; i++)
     {
         for (size_t j = 0; j < 15; j++)
         {
-            zob_blk[i][j] = dist(gen);
-            zob_wht[i][j] = dist(gen);
+            do t.blk[i][j] = splitmix64(state); while (t.blk[i][j] == 0);
+            do t.wht[i][j] = splitmix64(state); while (t.wht[i][j] == 0);
         }
     }
+
+    for (int sym = 0; sym < 8; sym++)
+    {
+        for (int i = 0; i < 15; i++)
+        {
+            for (int j = 0; j < 15; j++)
+            {
+                point_t p = transform({i, j}, sym);
+                t.sym_blk[sym][i][j] = t.blk[p.x][p.y];
+                t.sym_wht[sym][i][j] = t.wht[p.x][p.y];
+            }
+        }
+    }
+    return t;
 }
 
-size_t zobrist_val(int x, int y, gomoku_chess chess)
+inline constexpr zobrist_tables zobrist_keys = gen_zobrist_tables();
+
+inline constexpr zobrist_t const& zob_blk = zobrist_keys.blk;
+inline constexpr zobrist_t const& zob_wht = zobrist_keys.wht;
+inline constexpr std::array<zobrist_t, 8> const& zob_sym_blk = zobrist_keys.sym_blk;
+inline constexpr std::array<zobrist_t, 8> const& zob_sym_wht = zobrist_keys.sym_wht;
+
+constexpr size_t zobrist_val(int x, int y, gomoku_chess chess)
 {
     if (chess == EMPTY) return 0;
     return (chess == BLACK) ? zob_blk[x][y] : zob_wht[x][y];
 }
 
-size_t zobrist_val(point_t p, gomoku_chess chess) { return zobrist_val(p.x, p.y, chess); }
+constexpr size_t zobrist_val(point_t p, gomoku_chess chess) { return zobrist_val(p.x, p.y, chess); }
+
+// Keys of one position under all 8 symmetries, updated incrementally as
+// stones are placed or removed.
+struct symmetric_key
+{
+    std::array<uint64_t, 8> keys{};
+
+    // Placing and removing a stone are the same xor.
+    void toggle(point_t p, gomoku_chess chess)
+    {
+        if (chess == EMPTY) return;
+        auto const& table = (chess == BLACK) ? zob_sym_blk : zob_sym_wht;
+        for (int sym = 0; sym < 8; sym++)
+            keys[sym] ^= table[sym][p.x][p.y];
+    }
+
+    void toggle_side()
+    {
+        for (auto & k : keys)
+            k ^= zobrist_side;
+    }
+
+    // The smallest key over all orientations, together with the symmetry that
+    // produced it. Moves stored under the key live in that orientation.
+    std::pair<uint64_t, int> canonical() const
+    {
+        std::pair<uint64_t, int> best{keys[0], 0};
+        for (int sym = 1; sym < 8; sym++)
+            if (keys[sym] < best.first)
+                best = {keys[sym], sym};
+        return best;
+    }
+
+    static symmetric_key of(gomoku_board const& board)
+    {
+        symmetric_key key;
+        for (int i = 0; i < 15; i++)
+            for (int j = 0; j < 15; j++)
+                key.toggle({i, j}, board.getchess(i, j));
+        return key;
+    }
+};
+
+inline std::pair<uint64_t, int> canonical_key(gomoku_board const& board)
+{
+    return symmetric_key::of(board).canonical();
+}
 
 } // namespace nara
\ No newline at end of file